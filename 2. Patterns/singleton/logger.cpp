@@ -5,9 +5,32 @@
 #include <chrono>  // For high-resolution time
 #include <ctime>   // For converting time to string
 #include <iomanip> // For formatting the time output
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio> // remove() for the benchmark's log file, snprintf()
+#include <cstring>
+#include <sys/stat.h> // stat() for file sizes
+#include <sys/wait.h>
+#include <spawn.h> // posix_spawnp() to run gzip on rotated files
+#include <deque>
+#include <cctype>
+#include <set>
+#include <filesystem>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <iterator>
+#include <unordered_map>
 
 using namespace std;
 
+extern char **environ; // environment handed to posix_spawnp()
+
 // This Logger is a centralized communication center for your application.
 // Enum Class, also known as a Scoped Enumeration, introduced in C++11.
 // Enums are used when a variable needs to be one of a fixed set of possible values.
@@ -19,76 +42,958 @@ enum class LogLevel
     ERROR
 };
 
+// Lowest level compiled in (0 = DEBUG ... 3 = ERROR). Build with e.g. -DLOG_MIN_LEVEL=1 and every
+// LOG_DEBUG statement disappears from the binary, arguments and all.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// What an async log call does when the queue is full
+enum class OverflowPolicy
+{
+    BLOCK,      // wait for the writer to make room, nothing is lost
+    DROP,       // lose the new record, the caller never waits
+    DROP_OLDEST // lose the oldest queued record instead, the caller never waits
+};
+
+class ThreadLogBuffer;
+
+// One log call, as queued for the writer thread (formatting happens over there)
+struct LogRecord
+{
+    LogLevel level = LogLevel::INFO;
+    chrono::system_clock::time_point time;
+    string message;
+    // the calling thread's structured records, and this message's place among its messages: the
+    // writer keeps the thread's order across the queue and its buffer (see ThreadLogBuffer)
+    shared_ptr<ThreadLogBuffer> from;
+    uint64_t sequence = 0;
+};
+
+// Bounded queue of records, many threads push, the writer pops (a ring of slots, each with a sequence
+// number telling whose turn it is: no lock, a push or pop is one compare-and-swap on its index).
+// Pops are safe from any thread too, which is how DROP_OLDEST makes room.
+class RecordQueue
+{
+private:
+    struct Slot
+    {
+        atomic<size_t> sequence;
+        LogRecord record;
+    };
+
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> head{0}; // next position to push
+    alignas(64) atomic<size_t> tail{0}; // next position to pop
+
+public:
+    // capacity is rounded up to a power of two
+    explicit RecordQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++)
+            slots[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    // moves the record in, false (record untouched) if the queue is full
+    bool tryPush(LogRecord &record)
+    {
+        size_t pos = head.load(memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[pos & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                {
+                    slot.record = move(record);
+                    slot.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // the slot still holds a record from one lap ago
+            else
+                pos = head.load(memory_order_relaxed);
+        }
+    }
+
+    // approximate while pushes/pops are in flight
+    size_t size() const
+    {
+        size_t tailNow = tail.load(memory_order_relaxed);
+        size_t headNow = head.load(memory_order_relaxed);
+        return headNow > tailNow ? headNow - tailNow : 0;
+    }
+
+    size_t capacity() const
+    {
+        return mask + 1;
+    }
+
+    // false if empty
+    bool tryPop(LogRecord &record)
+    {
+        size_t pos = tail.load(memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = slots[pos & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                {
+                    record = move(slot.record);
+                    slot.sequence.store(pos + mask + 1, memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false; // nothing pushed here yet
+            else
+                pos = tail.load(memory_order_relaxed);
+        }
+    }
+};
+
+// Structured logging: the format string is registered once, a log call only stores its id and the raw
+// arguments (binary, see LogEncoding); "{}" in the format stands for the next argument. Formatting
+// happens later, on the writer thread or offline (./logger decode).
+//   static const LogFormat served(LogLevel::INFO, "worker {} served request {} in {} ms");
+//   logger.log(served, worker, request, millis);
+class LogFormat
+{
+private:
+    uint32_t id;
+    LogLevel level;
+
+    struct Table
+    {
+        mutex mtx;
+        vector<pair<LogLevel, string>> formats; // index = id
+    };
+
+    static Table &table()
+    {
+        static Table instance;
+        return instance;
+    }
+
+public:
+    LogFormat(LogLevel level, const char *format) : level(level)
+    {
+        Table &formats = table();
+        lock_guard<mutex> lock(formats.mtx);
+        id = static_cast<uint32_t>(formats.formats.size());
+        formats.formats.emplace_back(level, format);
+    }
+
+    uint32_t getId() const
+    {
+        return id;
+    }
+
+    LogLevel getLevel() const
+    {
+        return level;
+    }
+
+    static size_t count()
+    {
+        Table &formats = table();
+        lock_guard<mutex> lock(formats.mtx);
+        return formats.formats.size();
+    }
+
+    // copy: the table may grow while the caller uses it
+    static pair<LogLevel, string> get(uint32_t id)
+    {
+        Table &formats = table();
+        lock_guard<mutex> lock(formats.mtx);
+        return formats.formats[id];
+    }
+};
+
+// Binary log record: size(2) formatId(4) time(8, ns since epoch) then per argument a type byte + value
+// (integers as 8 bytes, doubles as 8 bytes, strings as length(2) + bytes). Written by the caller's
+// thread, turned into text wherever it is read.
+class LogEncoding
+{
+public:
+    static constexpr size_t MAX_RECORD = 1024; // longer string arguments are cut
+    static constexpr size_t HEADER = 14;
+    static constexpr uint32_t DEFINE = UINT32_MAX; // in a binary file: a format definition, not a record
+
+    enum class ArgType : uint8_t
+    {
+        INT,
+        UINT,
+        DOUBLE,
+        STRING
+    };
+
+    template <typename T>
+    static void put(char *&p, const T &value)
+    {
+        memcpy(p, &value, sizeof(T));
+        p += sizeof(T);
+    }
+
+    template <typename T>
+    static T get(const char *p)
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    static void putArg(char *&p, char *end, const T &value)
+    {
+        if (end - p < 1 + 8)
+            return; // record full, the rest of the arguments are left out
+        if constexpr (is_integral_v<T> and is_signed_v<T>)
+        {
+            put(p, ArgType::INT);
+            put(p, static_cast<int64_t>(value));
+        }
+        else if constexpr (is_integral_v<T>)
+        {
+            put(p, ArgType::UINT);
+            put(p, static_cast<uint64_t>(value));
+        }
+        else if constexpr (is_floating_point_v<T>)
+        {
+            put(p, ArgType::DOUBLE);
+            put(p, static_cast<double>(value));
+        }
+        else
+        {
+            string_view text(value);
+            size_t length = min<size_t>(text.size(), end - p - 3);
+            put(p, ArgType::STRING);
+            put(p, static_cast<uint16_t>(length));
+            memcpy(p, text.data(), length);
+            p += length;
+        }
+    }
+
+    // whole record into out (MAX_RECORD bytes), returns its size
+    template <typename... Args>
+    static size_t encode(char *out, uint32_t formatId, int64_t timeNs, const Args &...args)
+    {
+        char *p = out + 2;
+        char *end = out + MAX_RECORD;
+        put(p, formatId);
+        put(p, timeNs);
+        (putArg(p, end, args), ...);
+        uint16_t size = static_cast<uint16_t>(p - out);
+        memcpy(out, &size, sizeof(size));
+        return size;
+    }
+
+    // the format with every "{}" replaced by the next argument of the record (size >= HEADER) into text;
+    // false for a corrupt record: unknown argument type or an argument running past the record
+    static bool render(const string &format, const char *record, size_t size, string &text)
+    {
+        const char *p = record + HEADER;
+        const char *end = record + size;
+        size_t from = 0;
+        while (true)
+        {
+            size_t hole = format.find("{}", from);
+            if (hole == string::npos)
+                break;
+            text.append(format, from, hole - from);
+            from = hole + 2;
+            if (p >= end)
+            {
+                text += "{}";
+                continue;
+            }
+            ArgType type = get<ArgType>(p++);
+            if (type == ArgType::STRING)
+            {
+                if (end - p < 2 or end - p - 2 < get<uint16_t>(p))
+                    return false;
+                uint16_t length = get<uint16_t>(p);
+                text.append(p + 2, length);
+                p += 2 + length;
+                continue;
+            }
+            if (type > ArgType::STRING or end - p < 8)
+                return false;
+            if (type == ArgType::INT)
+                text += to_string(get<int64_t>(p));
+            else if (type == ArgType::UINT)
+                text += to_string(get<uint64_t>(p));
+            else
+            {
+                char number[32];
+                snprintf(number, sizeof(number), "%g", get<double>(p));
+                text += number;
+            }
+            p += 8;
+        }
+        text.append(format, from, string::npos);
+        return true;
+    }
+};
+
+// Byte ring of binary records from one thread to the writer thread (single producer, single consumer:
+// two counters, no lock, no CAS).
+// The thread's string messages travel through the shared queue instead. To keep the thread's order,
+// each record is stamped with how many messages the thread had queued before it: the writer takes a
+// record only once that many messages are written (or dropped), and before writing message n it
+// takes the records stamped <= n.
+class ThreadLogBuffer
+{
+private:
+    static constexpr size_t CAPACITY = 1 << 16;
+    static constexpr size_t STAMP = sizeof(uint64_t); // in the ring before each record
+    unique_ptr<char[]> ring; // allocated on the first record, threads logging only strings don't need it
+    alignas(64) atomic<size_t> written{0};  // bytes ever written, by the thread
+    alignas(64) atomic<size_t> consumed{0}; // bytes ever read, by the writer
+
+    void copyIn(size_t pos, const char *from, size_t size)
+    {
+        size_t at = pos % CAPACITY;
+        size_t first = min(size, CAPACITY - at);
+        memcpy(ring.get() + at, from, first);
+        memcpy(ring.get(), from + first, size - first);
+    }
+
+    void copyOut(size_t pos, char *to, size_t size) const
+    {
+        size_t at = pos % CAPACITY;
+        size_t first = min(size, CAPACITY - at);
+        memcpy(to, ring.get() + at, first);
+        memcpy(to + first, ring.get(), size - first);
+    }
+
+public:
+    atomic<bool> orphaned{false}; // its thread has exited, dropped once drained
+    uint64_t messagesQueued = 0;         // string messages the thread has queued, by the thread
+    atomic<uint64_t> messagesDone{0};    // of those, written by the writer or dropped as oldest
+
+    // false if there is no room
+    bool tryWrite(const char *record, size_t size)
+    {
+        size_t pos = written.load(memory_order_relaxed);
+        if (CAPACITY - (pos - consumed.load(memory_order_acquire)) < STAMP + size)
+            return false;
+        if (!ring)
+            ring.reset(new char[CAPACITY]);
+        copyIn(pos, reinterpret_cast<const char *>(&messagesQueued), STAMP);
+        copyIn(pos + STAMP, record, size);
+        written.store(pos + STAMP + size, memory_order_release);
+        return true;
+    }
+
+    // handle(record, size) for every record written so far that is stamped <= messages, returns how many
+    template <typename Handler>
+    size_t drain(Handler handle, uint64_t messages)
+    {
+        size_t pos = consumed.load(memory_order_relaxed);
+        size_t end = written.load(memory_order_acquire);
+        char record[LogEncoding::MAX_RECORD];
+        size_t count = 0;
+        while (pos < end)
+        {
+            uint64_t stamp;
+            copyOut(pos, reinterpret_cast<char *>(&stamp), STAMP);
+            if (stamp > messages)
+                break; // a message queued before it isn't written yet
+            uint16_t size;
+            copyOut(pos + STAMP, reinterpret_cast<char *>(&size), sizeof(size));
+            copyOut(pos + STAMP, record, size);
+            handle(record, size);
+            pos += STAMP + size;
+            count++;
+        }
+        consumed.store(pos, memory_order_release);
+        return count;
+    }
+
+    size_t writtenBytes() const
+    {
+        return written.load(memory_order_acquire);
+    }
+
+    bool halfFull() const
+    {
+        return written.load(memory_order_relaxed) - consumed.load(memory_order_relaxed) >= CAPACITY / 2;
+    }
+
+    size_t consumedBytes() const
+    {
+        return consumed.load(memory_order_acquire);
+    }
+};
+
+enum class TimestampPrecision
+{
+    SECONDS,
+    MILLISECONDS
+};
+
+// Line timestamps without a stringstream, put_time and localtime per record: the "[YYYY-MM-DD HH:MM:SS"
+// part is formatted with localtime_r once per second and kept, so a record costs a compare and a
+// memcpy (plus three digits in millisecond mode). One cache per thread, no locking.
+class TimestampCache
+{
+private:
+    time_t second = -1; // the one prefix is formatted for
+    char prefix[32];
+    size_t length = 0;
+
+public:
+    void append(string &out, chrono::system_clock::time_point time, TimestampPrecision precision)
+    {
+        int64_t millis = chrono::duration_cast<chrono::milliseconds>(time.time_since_epoch()).count();
+        int64_t millisOfSecond = ((millis % 1000) + 1000) % 1000; // before 1970 too
+        time_t now = static_cast<time_t>((millis - millisOfSecond) / 1000);
+        if (now != second)
+        {
+            tm local;
+            localtime_r(&now, &local);
+            length = strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S", &local);
+            second = now;
+        }
+        out.append(prefix, length);
+        if (precision == TimestampPrecision::MILLISECONDS)
+        {
+            char digits[4] = {'.', static_cast<char>('0' + millisOfSecond / 100), static_cast<char>('0' + millisOfSecond / 10 % 10),
+                              static_cast<char>('0' + millisOfSecond % 10)};
+            out.append(digits, sizeof(digits));
+        }
+        out.append("] ", 2);
+    }
+
+    static TimestampCache &local()
+    {
+        thread_local TimestampCache cache;
+        return cache;
+    }
+};
+
+// Rotation of the text log file. A file that would grow past maxBytes, or that has passed an interval
+// boundary, is renamed to <path>.<yyyymmdd-hhmmss>-<n> and a fresh one opened by whichever thread writes
+// the file: the writer thread in async mode, so callers never wait for it. A background thread then
+// gzips rotated files (optional) and deletes the oldest beyond keepFiles.
+struct LogRotation
+{
+    uint64_t maxBytes = 0;       // 0: no size limit
+    chrono::seconds interval{0}; // 0: no time limit, else at every multiple of it since the epoch
+    size_t keepFiles = 10;       // rotated files kept, oldest deleted first (0: keep all)
+    bool compress = false;       // gzip rotated files (needs gzip on the PATH)
+};
+
 class Logger
 {
 private:
-    // mutex mtx; // std::mutex is a synchronization tool used to prevent Race Conditions.
+    mutex mtx; // std::mutex is a synchronization tool used to prevent Race Conditions.
     LogLevel currentLevel;
     ofstream logFile; // File stream object
+    string logPath;
+
+    // Rotation (LogRotation), by whoever writes logFile
+    LogRotation rotation;
+    uint64_t fileBytes = 0; // size of the current file
+    chrono::system_clock::time_point nextRotation = chrono::system_clock::time_point::max();
+    uint64_t rotations = 0;
+
+    // Background housekeeping of rotated files: compress, enforce retention
+    thread housekeeper;
+    mutex housekeepingMtx;
+    condition_variable housekeepingReady;
+    condition_variable housekeepingIdle;
+    deque<pair<string, string>> rotatedFiles; // (rotated file, log path it came from)
+    bool housekeepingBusy = false;
+    bool housekeepingStop = false;
+    bool consoleOutput = true;
+    TimestampPrecision timestampPrecision = TimestampPrecision::SECONDS;
+
+    // Async mode: callers only queue, the writer thread formats and writes in batches
+    static constexpr size_t MAX_BATCH = 256;
+    unique_ptr<RecordQueue> queue;
+    OverflowPolicy overflow = OverflowPolicy::BLOCK;
+    thread writer;
+    atomic<bool> stopping{false};
+    atomic<bool> writerSleeping{false};
+    mutex wakeMtx;
+    condition_variable wake;    // writer: records are waiting
+    condition_variable drained; // flush(): the writer got further
+    atomic<uint64_t> accepted{0}; // records queued so far
+    atomic<uint64_t> removed{0};  // records taken off the queue again (written or dropped as oldest)
+    atomic<uint64_t> dropped{0};
+
+    // Structured records: one buffer per logging thread, drained by the writer (or written directly
+    // when not in async mode). They go to the text sinks, or raw to binaryFile when one is set.
+    mutex buffersMtx;
+    vector<shared_ptr<ThreadLogBuffer>> threadBuffers;
+    atomic<uint64_t> buffersVersion{0};
+    ofstream binaryFile;
+    size_t formatsWritten = 0; // definitions already in binaryFile
 
     // private constructor, prevents object creation
     Logger() : currentLevel(LogLevel::INFO)
     {
+        openLogFile("app.log");
+    }
+
+    void openLogFile(const string &path)
+    {
+        if (logFile.is_open())
+            logFile.close();
+        logPath = path;
         // Open file in "Append" mode so we don't delete old logs
-        logFile.open("app.log", ios::app);
+        logFile.open(path, ios::app);
         if (!logFile.is_open())
         {
             cerr << "Failed to open log file!" << endl;
         }
+        struct stat info;
+        fileBytes = stat(path.c_str(), &info) == 0 ? info.st_size : 0;
+        scheduleRotation();
     }
 
-    // Helper to get current timestamp as a string
-    string getTimestamp()
+    void scheduleRotation()
     {
-        auto now = chrono::system_clock::now();                // a template class,  A "Duration" (a count of ticks) since a specific "Clock's" epoch.
-        auto in_time_t = chrono::system_clock::to_time_t(now); // return time_t, which is basically number of seconds elapsed since unix epoch
+        if (rotation.interval.count() <= 0)
+        {
+            nextRotation = chrono::system_clock::time_point::max();
+            return;
+        }
+        auto sinceEpoch = chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch());
+        nextRotation = chrono::system_clock::time_point((sinceEpoch / rotation.interval + 1) * rotation.interval);
+    }
 
-        stringstream ss;
-        // Formats time as [YYYY-MM-DD HH:MM:SS]
-        ss << "[" << put_time(localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << "] ";
-        return ss.str();
+    // rename the current file out of the way and start a new one; the rest happens in the background
+    void rotateLogFile()
+    {
+        logFile.close();
+        time_t now = chrono::system_clock::to_time_t(chrono::system_clock::now());
+        tm local;
+        localtime_r(&now, &local);
+        char suffix[48];
+        size_t length = strftime(suffix, sizeof(suffix), ".%Y%m%d-%H%M%S", &local);
+        snprintf(suffix + length, sizeof(suffix) - length, "-%06llu", static_cast<unsigned long long>(++rotations));
+        string rotated = logPath + suffix;
+        bool renamed = rename(logPath.c_str(), rotated.c_str()) == 0;
+        openLogFile(logPath);
+        if (renamed)
+        {
+            lock_guard<mutex> lock(housekeepingMtx);
+            rotatedFiles.emplace_back(rotated, logPath);
+            housekeepingReady.notify_one();
+        }
+    }
+
+    // every write of the text file goes through here (writer thread, or under mtx when synchronous)
+    void writeToFile(const string &text)
+    {
+        if (!logFile.is_open())
+            return;
+        bool full = rotation.maxBytes > 0 and fileBytes > 0 and fileBytes + text.size() > rotation.maxBytes;
+        if (full or chrono::system_clock::now() >= nextRotation)
+            rotateLogFile();
+        logFile.write(text.data(), text.size()).flush();
+        fileBytes += text.size();
+    }
+
+    static void gzipFile(const string &path)
+    {
+        const char *argv[] = {"gzip", "-f", "--", path.c_str(), nullptr};
+        pid_t pid;
+        if (posix_spawnp(&pid, "gzip", nullptr, nullptr, const_cast<char *const *>(argv), environ) != 0)
+            return; // no gzip: the file stays as it is
+        int status;
+        waitpid(pid, &status, 0);
+    }
+
+    // delete the oldest rotated files of logPath (compressed or not) beyond keep; names sort by age
+    static void enforceRetention(const string &path, size_t keep)
+    {
+        if (keep == 0)
+            return;
+        filesystem::path base(path);
+        filesystem::path directory = base.has_parent_path() ? base.parent_path() : filesystem::path(".");
+        string prefix = base.filename().string() + ".";
+        set<string> rotated;
+        error_code error;
+        for (auto &entry : filesystem::directory_iterator(directory, error))
+        {
+            string name = entry.path().filename().string();
+            if (name.size() > prefix.size() and name.compare(0, prefix.size(), prefix) == 0 and isdigit(name[prefix.size()]))
+                rotated.insert(name);
+        }
+        while (rotated.size() > keep)
+        {
+            filesystem::remove(directory / *rotated.begin(), error);
+            rotated.erase(rotated.begin());
+        }
+    }
+
+    void housekeepingLoop()
+    {
+        unique_lock<mutex> lock(housekeepingMtx);
+        while (true)
+        {
+            housekeepingReady.wait(lock, [this]()
+                                   { return housekeepingStop or !rotatedFiles.empty(); });
+            if (rotatedFiles.empty())
+                break; // stopping and nothing left
+            // take everything queued: when rotation outpaces gzip, retention runs first so files about
+            // to be deleted are not compressed for nothing
+            deque<pair<string, string>> files;
+            files.swap(rotatedFiles);
+            LogRotation settings = rotation;
+            housekeepingBusy = true;
+            lock.unlock();
+
+            set<string> logPaths;
+            for (auto &file : files)
+                logPaths.insert(file.second);
+            for (auto &logPath : logPaths)
+                enforceRetention(logPath, settings.keepFiles);
+            if (settings.compress)
+            {
+                error_code error;
+                for (auto &file : files)
+                {
+                    if (filesystem::exists(file.first, error))
+                        gzipFile(file.first);
+                }
+            }
+
+            lock.lock();
+            housekeepingBusy = false;
+            housekeepingIdle.notify_all();
+        }
     }
 
     // prevent copy
     Logger(const Logger &) = delete;
     Logger &operator=(const Logger &) = delete;
 
+    void notifyWriter()
+    {
+        lock_guard<mutex> lock(wakeMtx);
+        wake.notify_one();
+    }
+
+    // Async: queue the record, what happens on a full queue is up to the overflow policy
+    // false if the record was dropped
+    bool enqueue(LogRecord &record)
+    {
+        while (!queue->tryPush(record))
+        {
+            if (overflow == OverflowPolicy::DROP)
+            {
+                dropped++;
+                return false;
+            }
+            if (overflow == OverflowPolicy::DROP_OLDEST)
+            {
+                LogRecord oldest;
+                if (queue->tryPop(oldest))
+                {
+                    oldest.from->messagesDone++; // its thread's later records must not wait for it
+                    dropped++;
+                    removed++;
+                }
+                continue;
+            }
+            // BLOCK: make sure the writer is awake, let it run
+            notifyWriter();
+            this_thread::yield();
+        }
+        accepted++;
+        if (queue->size() >= queue->capacity() / 2 and writerSleeping.load())
+            notifyWriter();
+        return true;
+    }
+
+    static chrono::system_clock::time_point timeOf(int64_t timeNs)
+    {
+        return chrono::system_clock::time_point(chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(timeNs)));
+    }
+
+    // A structured record as a text line, or (binary output) as raw bytes preceded by the definition
+    // of any format the file doesn't have yet
+    void appendStructured(const char *record, size_t size, string &text, string &binary)
+    {
+        uint32_t formatId = LogEncoding::get<uint32_t>(record + 2);
+        if (!binaryFile.is_open())
+        {
+            pair<LogLevel, string> format = LogFormat::get(formatId);
+            string message;
+            LogEncoding::render(format.second, record, size, message); // encoded in this process, always valid
+            appendLine(text, format.first, timeOf(LogEncoding::get<int64_t>(record + 6)), message, timestampPrecision);
+            text += '\n';
+            return;
+        }
+        for (; formatsWritten <= formatId; formatsWritten++)
+        {
+            pair<LogLevel, string> format = LogFormat::get(static_cast<uint32_t>(formatsWritten));
+            uint16_t length = static_cast<uint16_t>(min<size_t>(format.second.size(), LogEncoding::MAX_RECORD - 11));
+            char definition[11];
+            char *p = definition;
+            LogEncoding::put(p, static_cast<uint16_t>(11 + length));
+            LogEncoding::put(p, LogEncoding::DEFINE);
+            LogEncoding::put(p, static_cast<uint32_t>(formatsWritten));
+            LogEncoding::put(p, static_cast<uint8_t>(format.first));
+            binary.append(definition, sizeof(definition));
+            binary.append(format.second, 0, length);
+        }
+        binary.append(record, size);
+    }
+
+    // one write + one flush per batch, instead of per line
+    void writeBatch(const string &text, const string &binary)
+    {
+        if (!text.empty())
+        {
+            if (consoleOutput)
+                cout.write(text.data(), text.size()).flush();
+            writeToFile(text);
+        }
+        if (!binary.empty())
+            binaryFile.write(binary.data(), binary.size()).flush();
+    }
+
+    // the writer's copy of the buffer list, refreshed when a thread registered or left
+    size_t drainThreadBuffers(vector<shared_ptr<ThreadLogBuffer>> &buffers, uint64_t &version, string &text, string &binary)
+    {
+        if (version != buffersVersion.load())
+        {
+            lock_guard<mutex> lock(buffersMtx);
+            buffers = threadBuffers;
+            version = buffersVersion.load();
+        }
+        size_t count = 0;
+        bool orphans = false;
+        for (auto &buffer : buffers)
+        {
+            bool exited = buffer->orphaned.load(); // before draining: nothing comes after
+            count += buffer->drain([&](const char *record, size_t size)
+                                   { appendStructured(record, size, text, binary); },
+                                   buffer->messagesDone.load());
+            orphans |= exited;
+        }
+        if (orphans)
+        {
+            lock_guard<mutex> lock(buffersMtx);
+            threadBuffers.erase(remove_if(threadBuffers.begin(), threadBuffers.end(), [](const shared_ptr<ThreadLogBuffer> &buffer)
+                                          { return buffer->orphaned.load() and buffer->consumedBytes() == buffer->writtenBytes(); }),
+                                threadBuffers.end());
+            buffersVersion++;
+        }
+        return count;
+    }
+
+    const shared_ptr<ThreadLogBuffer> &localBuffer()
+    {
+        struct Holder
+        {
+            shared_ptr<ThreadLogBuffer> buffer;
+            ~Holder()
+            {
+                if (buffer)
+                    buffer->orphaned.store(true);
+            }
+        };
+        thread_local Holder holder;
+        if (!holder.buffer)
+        {
+            holder.buffer = make_shared<ThreadLogBuffer>();
+            lock_guard<mutex> lock(buffersMtx);
+            threadBuffers.push_back(holder.buffer);
+            buffersVersion++;
+        }
+        return holder.buffer;
+    }
+
+    // Drains the queue and the thread buffers, up to MAX_BATCH queued records per write, in each
+    // thread's own order (see ThreadLogBuffer). Polls every
+    // millisecond when there is nothing to do: waking it per record would cost the callers a syscall
+    // (and on a busy box a context switch) each, so they only wake it early when half full.
+    void writerLoop()
+    {
+        LogRecord record;
+        string batch, binary;
+        vector<shared_ptr<ThreadLogBuffer>> buffers;
+        uint64_t version = UINT64_MAX;
+        while (true)
+        {
+            batch.clear();
+            binary.clear();
+            size_t count = 0, structured = 0;
+            while (count < MAX_BATCH and queue->tryPop(record))
+            {
+                // the thread's structured records from before this message go first
+                structured += record.from->drain([&](const char *bytes, size_t size)
+                                                 { appendStructured(bytes, size, batch, binary); },
+                                                 record.sequence);
+                appendLine(batch, record.level, record.time, record.message, timestampPrecision);
+                batch += '\n';
+                record.from->messagesDone++;
+                count++;
+            }
+            structured += drainThreadBuffers(buffers, version, batch, binary);
+            if (count + structured > 0)
+            {
+                writeBatch(batch, binary);
+                removed += count;
+                lock_guard<mutex> lock(wakeMtx);
+                drained.notify_all();
+                continue;
+            }
+            if (stopping.load())
+                break; // stopping, and everything queued before has been written
+
+            unique_lock<mutex> lock(wakeMtx);
+            writerSleeping.store(true);
+            wake.wait_for(lock, chrono::milliseconds(1));
+            writerSleeping.store(false);
+        }
+    }
+
+    void stopWriter()
+    {
+        if (!writer.joinable())
+            return;
+        stopping.store(true);
+        notifyWriter();
+        writer.join();
+        queue.reset();
+        stopping.store(false);
+    }
+
     // Internal logging
     void logInternal(LogLevel level, const string &message)
     {
-        if (level < currentLevel)
+        if (!isEnabled(level))
+            return;
+
+        if (queue)
+        {
+            LogRecord record;
+            record.level = level;
+            record.time = chrono::system_clock::now();
+            record.message = message;
+            ThreadLogBuffer &buffer = *localBuffer();
+            record.from = localBuffer();
+            record.sequence = buffer.messagesQueued;
+            if (enqueue(record)) // moves record.from out
+                buffer.messagesQueued++;
             return;
+        }
+
+        lock_guard<mutex> lock(mtx); // It looks at the mtx. If the mutex is already locked by another thread, this thread pauses (blocks) and waits right here.
 
-        // lock_guard<mutex> lock(mtx); // It looks at the mtx. If the mutex is already locked by another thread, this thread pauses (blocks) and waits right here.
+        string logLine;
+        appendLine(logLine, level, chrono::system_clock::now(), message, timestampPrecision);
+        logLine += '\n';
 
-        string logLine = getTimestamp();
+        // Write to BOTH Console and File
+        writeBatch(logLine, "");
+    }
+
+public:
+    // Helper to get a timestamp as a string: the original per-record formatting (a stringstream,
+    // put_time and the non thread-safe localtime each time), kept to compare against in the benchmark
+    static string getTimestamp(chrono::system_clock::time_point now)
+    {
+        auto in_time_t = chrono::system_clock::to_time_t(now); // return time_t, which is basically number of seconds elapsed since unix epoch
+
+        stringstream ss;
+        // Formats time as [YYYY-MM-DD HH:MM:SS]
+        ss << "[" << put_time(localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << "] ";
+        return ss.str();
+    }
+
+    // One formatted line, without the newline, appended to out
+    static void appendLine(string &out, LogLevel level, chrono::system_clock::time_point time, string_view message,
+                           TimestampPrecision precision = TimestampPrecision::SECONDS)
+    {
+        TimestampCache::local().append(out, time, precision);
 
         switch (level)
         {
         case LogLevel::DEBUG:
-            logLine += "[DEBUG]: ";
+            out += "[DEBUG]: ";
             break;
         case LogLevel::INFO:
-            logLine += "[INFO]: ";
+            out += "[INFO]: ";
             break;
         case LogLevel::WARN:
-            logLine += "[WARN]: ";
+            out += "[WARN]: ";
             break;
         case LogLevel::ERROR:
-            logLine += "[ERROR]: ";
+            out += "[ERROR]: ";
             break;
         }
-        logLine += message;
+        out += message;
+    }
 
-        // Write to BOTH Console and File
-        cout << logLine << endl;
-        if (logFile.is_open())
+    // Offline decoder for a binary log (setBinaryOutput): the same text lines the logger would have
+    // written. Returns the number of records.
+    static size_t decodeBinaryLog(const string &path, ostream &out)
+    {
+        ifstream in(path, ios::binary);
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        if (data.compare(0, 8, "LOGBIN01") != 0)
+            return 0;
+        unordered_map<uint32_t, pair<LogLevel, string>> formats;
+        size_t records = 0;
+        const char *p = data.data() + 8;
+        const char *end = data.data() + data.size();
+        // a torn last record ends the file; so does a corrupt one, nothing after it can be trusted
+        while (end - p >= 6)
         {
-            logFile << logLine << endl;
+            uint16_t size = LogEncoding::get<uint16_t>(p);
+            if (size < 6 or end - p < size)
+                break; // torn last record
+            uint32_t formatId = LogEncoding::get<uint32_t>(p + 2);
+            if (formatId == LogEncoding::DEFINE)
+            {
+                if (size < 11 or p[10] > static_cast<char>(LogLevel::ERROR) or p[10] < 0)
+                    break;
+                formats[LogEncoding::get<uint32_t>(p + 6)] = {static_cast<LogLevel>(p[10]), string(p + 11, size - 11)};
+            }
+            else
+            {
+                if (size < LogEncoding::HEADER)
+                    break;
+                auto format = formats.find(formatId);
+                if (format != formats.end())
+                {
+                    string message;
+                    if (!LogEncoding::render(format->second.second, p, size, message))
+                        break;
+                    string line;
+                    appendLine(line, format->second.first, timeOf(LogEncoding::get<int64_t>(p + 6)), message);
+                    out << line << '\n';
+                    records++;
+                }
+            }
+            p += size;
         }
+        if (p != end)
+            cerr << path << ": torn or corrupt record at byte " << (p - data.data()) << ", decoding stopped there\n";
+        return records;
     }
 
-public:
     static Logger &getInstance()
     {
         static Logger instance;
@@ -100,6 +1005,154 @@ public:
         currentLevel = level;
     }
 
+    // compiled in and at or above the run-time level
+    bool isEnabled(LogLevel level) const
+    {
+        return static_cast<int>(level) >= LOG_MIN_LEVEL and level >= currentLevel;
+    }
+
+    // Configuration below: call before threads start logging
+
+    // Log to this file (appending) instead of app.log
+    void setLogFile(const string &path)
+    {
+        lock_guard<mutex> lock(mtx);
+        openLogFile(path);
+    }
+
+    // Rotate the text log file by size and/or time (LogRotation{} turns it off)
+    void setRotation(const LogRotation &settings)
+    {
+        lock_guard<mutex> lock(mtx);
+        {
+            lock_guard<mutex> housekeepingLock(housekeepingMtx);
+            rotation = settings;
+        }
+        scheduleRotation();
+        if (!housekeeper.joinable())
+            housekeeper = thread(&Logger::housekeepingLoop, this);
+    }
+
+    // wait until the files rotated so far are compressed and the retention limit applied
+    void flushRotatedFiles()
+    {
+        unique_lock<mutex> lock(housekeepingMtx);
+        housekeepingIdle.wait(lock, [this]()
+                              { return rotatedFiles.empty() and !housekeepingBusy; });
+    }
+
+    void setConsoleOutput(bool enabled)
+    {
+        consoleOutput = enabled;
+    }
+
+    // [YYYY-MM-DD HH:MM:SS] or, for MILLISECONDS, [YYYY-MM-DD HH:MM:SS.mmm]
+    void setTimestampPrecision(TimestampPrecision precision)
+    {
+        timestampPrecision = precision;
+    }
+
+    // Structured records (log()) go to this file as binary, much smaller and never formatted here;
+    // read it with decodeBinaryLog / ./logger decode. Empty path: back to the text sinks.
+    void setBinaryOutput(const string &path)
+    {
+        lock_guard<mutex> lock(mtx);
+        if (binaryFile.is_open())
+            binaryFile.close();
+        formatsWritten = 0;
+        if (path.empty())
+            return;
+        binaryFile.open(path, ios::binary | ios::trunc);
+        if (!binaryFile.is_open())
+        {
+            cerr << "Failed to open binary log file!" << endl;
+            return;
+        }
+        binaryFile.write("LOGBIN01", 8);
+    }
+
+    // Async mode: a log call only puts the record in a bounded queue (capacity records) and returns,
+    // a background thread formats and writes. Records still queued are written by flush(),
+    // disableAsync() or when the program ends.
+    void enableAsync(size_t capacity = 8192, OverflowPolicy policy = OverflowPolicy::BLOCK)
+    {
+        stopWriter();
+        queue = make_unique<RecordQueue>(capacity);
+        overflow = policy;
+        writer = thread(&Logger::writerLoop, this);
+    }
+
+    // back to writing on the caller's thread, after everything queued is written
+    void disableAsync()
+    {
+        stopWriter();
+    }
+
+    // Async mode: wait until every record logged so far is written (or dropped as oldest)
+    void flush()
+    {
+        if (!queue)
+            return;
+        uint64_t target = accepted.load();
+        vector<pair<shared_ptr<ThreadLogBuffer>, size_t>> buffers;
+        {
+            lock_guard<mutex> lock(buffersMtx);
+            for (auto &buffer : threadBuffers)
+                buffers.emplace_back(buffer, buffer->writtenBytes());
+        }
+        notifyWriter();
+        unique_lock<mutex> lock(wakeMtx);
+        drained.wait(lock, [&]()
+                     {
+            for (auto &buffer : buffers)
+            {
+                if (buffer.first->consumedBytes() < buffer.second)
+                    return false;
+            }
+            return removed.load() >= target; });
+    }
+
+    // records lost to a full queue (DROP / DROP_OLDEST)
+    uint64_t getDropped() const
+    {
+        return dropped.load();
+    }
+
+    // Structured: only the format's id and the raw arguments are stored (numbers, strings), in this
+    // thread's own buffer; no string is built on the caller's thread in async mode.
+    // A full buffer blocks or drops as set by the overflow policy (DROP_OLDEST drops the new record).
+    template <typename... Args>
+    void log(const LogFormat &format, const Args &...args)
+    {
+        if (!isEnabled(format.getLevel()))
+            return;
+        char record[LogEncoding::MAX_RECORD];
+        int64_t timeNs = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+        size_t size = LogEncoding::encode(record, format.getId(), timeNs, args...);
+
+        if (!queue)
+        {
+            lock_guard<mutex> lock(mtx);
+            string text, binary;
+            appendStructured(record, size, text, binary);
+            writeBatch(text, binary);
+            return;
+        }
+        ThreadLogBuffer &buffer = *localBuffer();
+        while (!buffer.tryWrite(record, size))
+        {
+            if (overflow != OverflowPolicy::BLOCK)
+            {
+                dropped++;
+                return;
+            }
+            notifyWriter();
+            this_thread::yield();
+        }
+        if (buffer.halfFull() and writerSleeping.load())
+            notifyWriter();
+    }
+
     void debug(const string &message)
     {
         logInternal(LogLevel::DEBUG, message);
@@ -123,6 +1176,16 @@ public:
     // Destructor to close the file properly
     ~Logger()
     {
+        stopWriter();
+        if (housekeeper.joinable())
+        {
+            {
+                lock_guard<mutex> lock(housekeepingMtx);
+                housekeepingStop = true;
+            }
+            housekeepingReady.notify_one();
+            housekeeper.join();
+        }
         if (logFile.is_open())
         {
             logFile.close();
@@ -130,8 +1193,395 @@ public:
     }
 };
 
-int main()
+// Log statements: LOG_INFO("worker {} served request {}", worker, request);
+// Below LOG_MIN_LEVEL the statement is compiled out. Otherwise the arguments (and the LogFormat
+// registration) are only evaluated when the level is enabled at run time, so a disabled
+// LOG_DEBUG("{}", describe(order)) never calls describe().
+#define LOG_AT(level, format, ...)                                            \
+    do                                                                        \
+    {                                                                         \
+        if constexpr (static_cast<int>(level) >= LOG_MIN_LEVEL)               \
+        {                                                                     \
+            if (Logger::getInstance().isEnabled(level))                       \
+            {                                                                 \
+                static const LogFormat logStatementFormat(level, format);     \
+                Logger::getInstance().log(logStatementFormat, ##__VA_ARGS__); \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+#define LOG_DEBUG(format, ...) LOG_AT(LogLevel::DEBUG, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_AT(LogLevel::INFO, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) LOG_AT(LogLevel::WARN, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) LOG_AT(LogLevel::ERROR, format, ##__VA_ARGS__)
+
+// Caller-side latency and throughput, synchronous vs async (each overflow policy), 1..32 threads.
+// Every thread logs its share of a fixed number of records into bench.log (console off).
+void benchmarkLogging()
 {
+    Logger &logger = Logger::getInstance();
+    const string path = "bench.log";
+    remove(path.c_str());
+    logger.setLogFile(path);
+    logger.setConsoleOutput(false);
+    logger.setLogLevel(LogLevel::INFO);
+
+    const int total = 200000;
+    const char *modes[] = {"sync", "async block", "async drop", "async drop-oldest"};
+    const OverflowPolicy policies[] = {OverflowPolicy::BLOCK, OverflowPolicy::BLOCK, OverflowPolicy::DROP, OverflowPolicy::DROP_OLDEST};
+    cout << "logging " << total << " records: caller latency (every 16th call timed), throughput until the callers\n"
+         << "are done and until everything is written (dropped records count as written)\n";
+    for (int threads : {1, 2, 4, 8, 16, 32})
+    {
+        for (int mode = 0; mode < 4; mode++)
+        {
+            if (mode > 0)
+                logger.enableAsync(8192, policies[mode]);
+            uint64_t droppedBefore = logger.getDropped();
+            vector<vector<double>> latencies(threads);
+            vector<thread> workers;
+            auto t0 = chrono::steady_clock::now();
+            for (int t = 0; t < threads; t++)
+                workers.emplace_back([&, t]()
+                                     {
+                    string message = "worker " + to_string(t) + " processed request";
+                    for (int i = 0; i < total / threads; i++)
+                    {
+                        if (i % 16 != 0)
+                        {
+                            logger.info(message);
+                            continue;
+                        }
+                        auto start = chrono::steady_clock::now();
+                        logger.info(message);
+                        latencies[t].push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - start).count());
+                    } });
+            for (auto &worker : workers)
+                worker.join();
+            double callersSecs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+            logger.flush();
+            double writtenSecs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+            if (mode > 0)
+                logger.disableAsync();
+
+            vector<double> all;
+            for (auto &samples : latencies)
+                all.insert(all.end(), samples.begin(), samples.end());
+            sort(all.begin(), all.end());
+            cout << "  threads=" << setw(2) << threads << "  " << setw(17) << left << modes[mode] << right << fixed << setprecision(0)
+                 << "  call p50 " << setw(5) << all[all.size() / 2] << " ns  p99 " << setw(5) << all[all.size() * 99 / 100]
+                 << " ns  max " << setw(8) << all.back() << " ns" << setprecision(2)
+                 << "  callers " << setw(5) << total / callersSecs / 1e6 << " M rec/s"
+                 << "  written " << setw(5) << total / writtenSecs / 1e6 << " M rec/s"
+                 << "  dropped " << logger.getDropped() - droppedBefore << defaultfloat << "\n";
+        }
+    }
+    logger.setConsoleOutput(true);
+    logger.setLogFile("app.log");
+    remove(path.c_str());
+}
+
+static double threadCpuNs()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// Same records three ways, async: message string built by the caller, structured to text, structured
+// to a binary file. Caller cost = CPU time of the logging threads per call (what the writer does on
+// their behalf is not in it).
+void benchmarkStructuredLogging()
+{
+    static const LogFormat served(LogLevel::INFO, "worker {} served request {} in {} ms from {}");
+    Logger &logger = Logger::getInstance();
+    const string textPath = "bench.log", binaryPath = "bench.bin";
+    logger.setConsoleOutput(false);
+    logger.setLogLevel(LogLevel::INFO);
+
+    const int total = 400000;
+    const char *modes[] = {"string message", "structured, text", "structured, binary"};
+    cout << "logging " << total << " records, async: caller CPU per call and file size\n";
+    for (int threads : {1, 4, 16})
+    {
+        for (int mode = 0; mode < 3; mode++)
+        {
+            remove(textPath.c_str());
+            remove(binaryPath.c_str());
+            logger.setLogFile(textPath);
+            logger.setBinaryOutput(mode == 2 ? binaryPath : "");
+            logger.enableAsync(8192, OverflowPolicy::BLOCK);
+            vector<double> cpuNs(threads);
+            vector<thread> workers;
+            auto t0 = chrono::steady_clock::now();
+            for (int t = 0; t < threads; t++)
+                workers.emplace_back([&, t]()
+                                     {
+                    double start = threadCpuNs();
+                    for (int i = 0; i < total / threads; i++)
+                    {
+                        double millis = 0.25 * (i % 64);
+                        if (mode == 0)
+                            logger.info("worker " + to_string(t) + " served request " + to_string(i) + " in " + to_string(millis) + " ms from 10.0.0.1");
+                        else
+                            logger.log(served, t, i, millis, "10.0.0.1");
+                    }
+                    cpuNs[t] = threadCpuNs() - start; });
+            for (auto &worker : workers)
+                worker.join();
+            logger.flush();
+            double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+            logger.disableAsync();
+            logger.setBinaryOutput("");
+
+            double callerNs = 0;
+            for (double ns : cpuNs)
+                callerNs += ns;
+            struct stat info;
+            stat(mode == 2 ? binaryPath.c_str() : textPath.c_str(), &info);
+            cout << "  threads=" << setw(2) << threads << "  " << setw(18) << left << modes[mode] << right << fixed << setprecision(1)
+                 << "  caller " << setw(6) << callerNs / total << " ns/call  written " << setprecision(2) << setw(5) << total / secs / 1e6
+                 << " M rec/s  file " << setw(6) << info.st_size / 1024 << " KiB" << defaultfloat;
+            if (mode == 2)
+            {
+                ofstream sink("/dev/null");
+                cout << "  (decoded " << Logger::decodeBinaryLog(binaryPath, sink) << " records)";
+            }
+            cout << "\n";
+        }
+    }
+    logger.setConsoleOutput(true);
+    logger.setLogFile("app.log");
+    remove(textPath.c_str());
+    remove(binaryPath.c_str());
+}
+
+// Lines formatted per second, single thread, clock read included: the original timestamp (stringstream,
+// put_time, localtime per record) vs the cache
+void benchmarkTimestamps()
+{
+    const int records = 1000000;
+    const string message = "worker 3 served request 12345 in 2.5 ms";
+    cout << "timestamp formatting, " << records << " lines\n";
+    auto run = [&](const char *name, auto formatLine)
+    {
+        string line;
+        size_t bytes = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < records; i++)
+        {
+            line.clear();
+            formatLine(line);
+            bytes += line.size();
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  " << setw(26) << left << name << right << fixed << setprecision(2) << setw(6) << records / secs / 1e6
+             << " M lines/s  " << setprecision(1) << setw(6) << secs * 1e9 / records << " ns/line  (" << bytes / records << " B)\n"
+             << defaultfloat;
+    };
+    run("original", [&](string &line)
+        {
+        line += Logger::getTimestamp(chrono::system_clock::now());
+        line += "[INFO]: ";
+        line += message; });
+    run("cached, seconds", [&](string &line)
+        { Logger::appendLine(line, LogLevel::INFO, chrono::system_clock::now(), message); });
+    run("cached, milliseconds", [&](string &line)
+        { Logger::appendLine(line, LogLevel::INFO, chrono::system_clock::now(), message, TimestampPrecision::MILLISECONDS); });
+    run("clock read only", [&](string &line)
+        { line += static_cast<char>(chrono::system_clock::now().time_since_epoch().count()); });
+}
+
+// stands for work a log argument would cost (formatting an object, a lookup, ...)
+string describeValue(uint64_t value)
+{
+    return "value " + to_string(value) + " (" + to_string(value % 97) + " mod 97)";
+}
+
+// A tight loop with a DEBUG statement while the level is INFO: what a disabled log costs
+void benchmarkDisabledLogging()
+{
+    Logger &logger = Logger::getInstance();
+    logger.setLogLevel(LogLevel::INFO);
+    const int iterations = 20000000;
+    cout << "disabled DEBUG logging in a tight loop (" << iterations << " iterations, level INFO"
+         << (LOG_MIN_LEVEL > 0 ? ", LOG_DEBUG compiled out" : "") << ")\n";
+    auto run = [&](const char *name, auto body)
+    {
+        uint64_t sum = 1;
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+        {
+            sum = sum * 6364136223846793005ULL + i;
+            body(sum);
+        }
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / iterations;
+        volatile uint64_t keep = sum;
+        (void)keep;
+        cout << "  " << setw(38) << left << name << right << fixed << setprecision(2) << setw(7) << ns << " ns/iteration\n"
+             << defaultfloat;
+    };
+    run("no log statement", [](uint64_t) {});
+    run("logger.debug(describeValue(x))", [&](uint64_t x)
+        { logger.debug(describeValue(x)); });
+    run("LOG_DEBUG(\"{}\", describeValue(x))", [&](uint64_t x)
+        { LOG_DEBUG("{}", describeValue(x)); });
+    run("LOG_DEBUG(\"x={}\", x)", [&](uint64_t x)
+        { LOG_DEBUG("x={}", x); });
+}
+
+// lines of a log file, rotated ones included (.gz read through gzip)
+static vector<string> readLogLines(const string &path)
+{
+    vector<string> lines;
+    if (path.size() > 3 and path.compare(path.size() - 3, 3, ".gz") == 0)
+    {
+        FILE *pipe = popen(("gzip -dc '" + path + "'").c_str(), "r");
+        if (!pipe)
+            return lines;
+        char buffer[4096];
+        string line;
+        while (fgets(buffer, sizeof(buffer), pipe))
+        {
+            line += buffer;
+            if (!line.empty() and line.back() == '\n')
+            {
+                line.pop_back();
+                lines.push_back(line);
+                line.clear();
+            }
+        }
+        pclose(pipe);
+        return lines;
+    }
+    ifstream in(path);
+    string line;
+    while (getline(in, line))
+        lines.push_back(line);
+    return lines;
+}
+
+// Rotation under concurrent writers: 8 threads log numbered lines, every thread alternating between
+// string and structured calls (runs of 1-3, the two take different paths to the writer thread), while
+// the file rotates every 256 KiB, then every line must be found exactly once, in order per thread,
+// across the current and the rotated files. Synchronous, async, then async with gzip and a retention
+// limit (there the deleted files are accounted for by count).
+void checkRotation()
+{
+    static const LogFormat numbered(LogLevel::INFO, "rotation-check thread {} line {}");
+    Logger &logger = Logger::getInstance();
+    const string directory = "rotation-check";
+    const string path = directory + "/app.log";
+    const int threads = 8, perThread = 25000;
+    logger.setConsoleOutput(false);
+    logger.setLogLevel(LogLevel::INFO);
+    cout << "log rotation under " << threads << " writer threads, " << threads * perThread << " lines\n";
+
+    for (int run = 0; run < 3; run++)
+    {
+        bool async = run > 0;
+        filesystem::remove_all(directory);
+        filesystem::create_directory(directory);
+        LogRotation settings;
+        settings.maxBytes = 256 * 1024;
+        settings.compress = run == 2;
+        settings.keepFiles = run == 2 ? 5 : 0;
+        logger.setLogFile(path);
+        logger.setRotation(settings);
+        if (async)
+            logger.enableAsync(8192, OverflowPolicy::BLOCK);
+
+        auto t0 = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([&, t]()
+                                 {
+                for (int i = 0; i < perThread; i++)
+                {
+                    if (i / (1 + t % 3) % 2 == 0)
+                        logger.info("rotation-check thread " + to_string(t) + " line " + to_string(i));
+                    else
+                        logger.log(numbered, t, i);
+                } });
+        for (auto &worker : workers)
+            worker.join();
+        logger.flush();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if (async)
+            logger.disableAsync();
+        logger.flushRotatedFiles();
+        logger.setRotation(LogRotation());
+        logger.setLogFile("app.log");
+
+        // oldest first: rotated files by name, then the current file
+        vector<string> files;
+        for (auto &entry : filesystem::directory_iterator(directory))
+        {
+            if (entry.path().filename() != "app.log")
+                files.push_back(entry.path().string());
+        }
+        sort(files.begin(), files.end());
+        size_t rotatedKept = files.size(), compressed = 0;
+        files.push_back(path);
+
+        vector<vector<char>> seen(threads, vector<char>(perThread, 0));
+        vector<int> last(threads, -1);
+        size_t lines = 0, duplicated = 0, outOfOrder = 0, firstLine = SIZE_MAX;
+        for (const string &file : files)
+        {
+            compressed += file.size() > 3 and file.compare(file.size() - 3, 3, ".gz") == 0;
+            for (const string &line : readLogLines(file))
+            {
+                size_t at = line.find("rotation-check thread ");
+                int t, i;
+                if (at == string::npos or sscanf(line.c_str() + at, "rotation-check thread %d line %d", &t, &i) != 2)
+                    continue;
+                lines++;
+                duplicated += seen[t][i]++ > 0;
+                outOfOrder += i < last[t];
+                last[t] = i;
+                firstLine = min(firstLine, static_cast<size_t>(t) * perThread + i);
+            }
+        }
+        // with retention, the deleted (oldest) files take the first lines of every thread with them
+        size_t lost = 0;
+        for (int t = 0; t < threads; t++)
+        {
+            int firstSeen = 0;
+            while (firstSeen < perThread and !seen[t][firstSeen])
+                firstSeen++;
+            for (int i = firstSeen; i < perThread; i++)
+                lost += !seen[t][i];
+        }
+        const char *names[] = {"synchronous, keep all", "async, keep all", "async, gzip, keep 5"};
+        cout << "  " << names[run] << ": " << secs << " s, " << rotatedKept
+             << " rotated files kept (" << compressed << " compressed), " << lines << " lines read, lost " << lost
+             << ", duplicated " << duplicated << ", out of order " << outOfOrder << "\n";
+    }
+    filesystem::remove_all(directory);
+    logger.setConsoleOutput(true);
+}
+
+int main(int argc, char *argv[])
+{
+    // ./logger bench
+    if (argc > 1 and string(argv[1]) == "bench")
+    {
+        benchmarkDisabledLogging();
+        benchmarkTimestamps();
+        benchmarkLogging();
+        benchmarkStructuredLogging();
+        checkRotation();
+        return 0;
+    }
+
+    // ./logger decode <file>: a binary log (Logger::setBinaryOutput) as text
+    if (argc > 2 and string(argv[1]) == "decode")
+    {
+        Logger::decodeBinaryLog(argv[2], cout);
+        return 0;
+    }
+
     // singleton for logger, otherwise each file / module creates its own Logger object. Single instance give app wise single logging system
     Logger &logger = Logger::getInstance(); // Logger logger=Logger::getInstance(); will create copy, any modification will not modify the global object
 
@@ -141,4 +1591,4 @@ int main()
     logger.warn("Low memory warning");
     logger.error("Unhandled exception occurred");
     return 0;
-}
\ No newline at end of file
+}
@@ -1,13 +1,34 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <memory> // for mutex
 #include <algorithm>
 #include <mutex>
+#include <atomic>
+#include <thread>
 #include <unistd.h> //for sleep()
 #include <math.h>
-#include <ctime> //for time_t
+#include <ctime> //for time_t, clock_gettime
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <queue>
+#include <random>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <deque>
+#include <fcntl.h> // open() for the journal
+#include <cerrno>
+#include <sys/mman.h> // mmap() for spot maps
+#include <sys/stat.h>
+#include <sys/resource.h> // getrusage() page fault counts in the spot map benchmark
 
 /*
 Entities → stable ->  Vehicle, ParkingSpot, ParkingFloor, Ticket
@@ -24,7 +45,7 @@ enum class VehicleType
     TRUCK
 };
 
-enum class SpotType
+enum class SpotType : uint8_t // one byte per spot in a floor (and in a spot map file)
 {
     BIKE,
     CAR,
@@ -53,7 +74,7 @@ public:
         return type;
     }
 
-    string getVehicleId() const
+    const string &getVehicleId() const
     {
         return vehicleId;
     }
@@ -70,13 +91,59 @@ public:
     }
 };
 
+// Index into the lot's VehiclePool, what spots and tickets hold instead of a shared_ptr<Vehicle>.
+using VehicleHandle = uint32_t;
+const VehicleHandle NO_VEHICLE = UINT32_MAX;
+
+// Vehicles currently inside a lot, copied in at the gate and dropped when the ticket closes.
+// deque: elements never move, released handles are reused -> no allocation per park once warmed up
+// and no atomic reference counting on the park/unpark path.
+// Not thread-safe on its own, ParkingLot guards it together with the TicketTable.
+class VehiclePool
+{
+private:
+    deque<Vehicle> vehicles;
+    vector<VehicleHandle> freeHandles;
+
+public:
+    VehicleHandle acquire(const Vehicle &vehicle)
+    {
+        if (freeHandles.empty())
+        {
+            vehicles.push_back(vehicle);
+            return static_cast<VehicleHandle>(vehicles.size() - 1);
+        }
+        VehicleHandle handle = freeHandles.back();
+        freeHandles.pop_back();
+        vehicles[handle] = vehicle;
+        return handle;
+    }
+
+    const Vehicle &get(VehicleHandle handle) const
+    {
+        return vehicles[handle];
+    }
+
+    void release(VehicleHandle handle)
+    {
+        freeHandles.push_back(handle);
+    }
+
+    size_t size() const
+    {
+        return vehicles.size() - freeHandles.size();
+    }
+};
+
+// Description of a spot (id + type), e.g. to hand to ParkingFloor::addSpot.
+// Also usable standalone; inside a floor the spot data is kept in the floor's own arrays.
 class ParkingSpot
 {
 protected:
     string spotId;
     SpotType type;
-    bool occupied;
-    shared_ptr<Vehicle> vehicle;
+    atomic<bool> occupied; // claimed with compare-and-swap, a standalone spot is never handed out twice
+    VehicleHandle vehicle = NO_VEHICLE;
 
 public:
     ParkingSpot(string id, SpotType type)
@@ -89,22 +156,41 @@ public:
         return !occupied and static_cast<int>(type) >= static_cast<int>(vtype);
     }
 
-    void parkVehicle(shared_ptr<Vehicle> v)
+    // false -> true exactly once, whoever wins the CAS owns the spot
+    bool tryClaim()
     {
-        occupied = true;
+        bool expected = false;
+        return occupied.compare_exchange_strong(expected, true, memory_order_acq_rel);
+    }
+
+    bool parkVehicle(VehicleHandle v)
+    {
+        if (!tryClaim())
+            return false;
         vehicle = v;
+        return true;
     }
 
     void removeVehicle()
     {
-        occupied = false;
-        vehicle.reset();
+        vehicle = NO_VEHICLE;
+        occupied.store(false, memory_order_release);
     }
 
     bool isOccupied() const
     {
         return occupied;
     }
+
+    SpotType getType() const
+    {
+        return type;
+    }
+
+    string getSpotId() const
+    {
+        return spotId;
+    }
 };
 
 // “Factory isolates object creation and avoids scattering new logic.”
@@ -117,213 +203,5233 @@ public:
     }
 };
 
-class ParkingFloor
+class ParkingFloor;
+
+// Lightweight handle to a spot stored inside a ParkingFloor, used where a ParkingSpot* used to be.
+// Just (floor, index) -> copyable, no allocation, valid as long as the floor lives.
+class SpotView
 {
 private:
-    int floorNumber;
-    vector<unique_ptr<ParkingSpot>> spots;
+    ParkingFloor *floor = nullptr;
+    uint32_t index = 0;
 
 public:
-    ParkingFloor(int number) : floorNumber(number) {}
-    void addSpot(unique_ptr<ParkingSpot> spot)
+    SpotView() = default;
+    SpotView(ParkingFloor *f, uint32_t i) : floor(f), index(i) {}
+
+    explicit operator bool() const
+    {
+        return floor != nullptr;
+    }
+
+    ParkingFloor *getFloor() const
+    {
+        return floor;
+    }
+
+    uint32_t getIndex() const
+    {
+        return index;
+    }
+
+    // defined after ParkingFloor
+    SpotType getType() const;
+    string getSpotId() const;
+    bool isOccupied() const;
+};
+
+// Free / total spots per SpotType on one floor, index = static_cast<int>(SpotType)
+struct FloorAvailability
+{
+    int floorNumber = 0;
+    uint32_t freeSpots[3] = {0, 0, 0};
+    uint32_t totalSpots[3] = {0, 0, 0};
+
+    uint32_t occupiedSpots(SpotType type) const
+    {
+        return totalSpots[static_cast<int>(type)] - freeSpots[static_cast<int>(type)];
+    }
+};
+
+// Growable array that can also live inside a memory-mapped file: the elements are used in place,
+// the first push_back past the mapped room copies them out to the heap. Only what ParkingFloor needs.
+template <typename T>
+class Column
+{
+private:
+    vector<T> owned;
+    T *items = nullptr;
+    size_t count = 0;
+    size_t room = 0; // of the mapped region
+    bool mapped = false;
+
+public:
+    Column() = default;
+    Column(const Column &) = delete;
+    Column &operator=(const Column &) = delete;
+
+    // work on size elements at region, with space for capacity (region must outlive the column)
+    void map(char *region, size_t size, size_t capacity)
     {
-        spots.push_back(move(spot));
+        owned = vector<T>();
+        items = reinterpret_cast<T *>(region);
+        count = size;
+        room = capacity;
+        mapped = true;
     }
-    ParkingSpot *findAvailableSpot(VehicleType type)
+
+    void push_back(const T &value)
     {
-        for (auto &spot : spots)
+        if (mapped and count == room)
         {
-            if (spot->canFitVehicle(type))
-            {
-                // When you call .get(), you are asking the smart pointer for the address of the resource it owns without transferring ownership
-                return spot.get(); // return spot not allowed, as copy. return move(spot) will remove spot from spots vector
-            }
+            owned.assign(items, items + count);
+            mapped = false;
         }
-        return nullptr;
+        if (mapped)
+            items[count] = value;
+        else
+        {
+            owned.push_back(value);
+            items = owned.data();
+        }
+        count++;
+    }
+
+    void pop_back()
+    {
+        count--;
+        if (!mapped)
+            owned.pop_back();
+    }
+
+    T &operator[](size_t i)
+    {
+        return items[i];
+    }
+
+    const T &operator[](size_t i) const
+    {
+        return items[i];
+    }
+
+    T &back()
+    {
+        return items[count - 1];
+    }
+
+    const T &back() const
+    {
+        return items[count - 1];
+    }
+
+    T *begin()
+    {
+        return items;
+    }
+
+    T *end()
+    {
+        return items + count;
+    }
+
+    const T *begin() const
+    {
+        return items;
+    }
+
+    const T *end() const
+    {
+        return items + count;
+    }
+
+    const T *data() const
+    {
+        return items;
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
     }
 };
 
-class Ticket
+// Interning: every distinct string is stored once, users keep a 32-bit index.
+// All strings sit back to back in one buffer (mappable, see Column); the lookup for intern() is only
+// built when a pool that came from a file is first added to.
+class StringPool
 {
 private:
-    string ticketId;
-    shared_ptr<Vehicle> vehicle;
-
-    /*
-     Why NOT shared_ptr<ParkingSpot>?
-        Ticket co-owns the spot ❌
-        Spot might live longer than floor ❌
-        Lifecycle becomes unclear ❌
-    */
-    ParkingSpot *spot;
-    time_t entryTime;
-    time_t exitTime;
+    Column<uint32_t> offsets; // string i = bytes[offsets[i], offsets[i + 1])
+    Column<char> bytes;
+    unordered_map<string, uint32_t> lookup;
+    uint32_t indexed = 0; // strings already in lookup
 
 public:
-    Ticket(string id, shared_ptr<Vehicle> v, ParkingSpot *s)
-        : ticketId(id), vehicle(v), spot(s)
+    StringPool()
     {
-        entryTime = time(nullptr);
+        offsets.push_back(0);
     }
 
-    void closeTicket()
+    void map(char *offsetRegion, uint32_t count, char *byteRegion, uint32_t byteCount)
     {
-        exitTime = time(nullptr);
+        offsets.map(offsetRegion, count + 1, count + 1);
+        bytes.map(byteRegion, byteCount, byteCount);
+        lookup.clear();
+        indexed = 0;
     }
-    time_t getEntryTime() const
+
+    uint32_t intern(const string &value)
     {
-        return entryTime;
+        for (; indexed < size(); indexed++)
+            lookup.emplace(string(get(indexed)), indexed);
+        auto it = lookup.find(value);
+        if (it != lookup.end())
+            return it->second;
+        uint32_t id = size();
+        for (char c : value)
+            bytes.push_back(c);
+        offsets.push_back(static_cast<uint32_t>(bytes.size()));
+        lookup.emplace(value, id);
+        indexed = size();
+        return id;
     }
 
-    ParkingSpot *getParkingSpot() const
+    string_view get(uint32_t id) const
     {
-        return spot;
+        return string_view(bytes.data() + offsets[id], offsets[id + 1] - offsets[id]);
     }
 
-    time_t getExitTime() const
+    uint32_t size() const
     {
-        return exitTime;
+        return static_cast<uint32_t>(offsets.size() - 1);
     }
 
-    VehicleType getVehicleType() const
+    uint32_t byteSize() const
     {
-        return vehicle->getType();
+        return static_cast<uint32_t>(bytes.size());
     }
 
-    // no destructor to delete spot, as spot is owned by ParkingFloor
+    const uint32_t *offsetData() const
+    {
+        return offsets.data();
+    }
+
+    const char *byteData() const
+    {
+        return bytes.data();
+    }
 };
 
-// Pricing Strategies
-class PricingStrategy
+// Spot map: a lot's floors and spots in the exact in-memory form of ParkingFloor, so a file can be
+// mmap'ed and used without parsing (ParkingLot::loadSpotMap / writeSpotMap). File = "PLMAP001",
+// uint32 floor count, uint32 reserved, then one block per floor: this header + its columns.
+// Occupancy is part of the layout (the floor claims spots in place) but always written empty:
+// vehicles come back from the journal/snapshot, not from the map.
+struct SpotMapFloor
 {
-public:
-    virtual double calculatePrice(time_t entry, time_t exit, VehicleType type) = 0;
-    virtual ~PricingStrategy() = default;
+    int32_t floorNumber = 0;
+    uint32_t spotCount = 0;
+    uint32_t words = 0; // per bitset
+    uint32_t idCount = 0;
+    uint32_t idBytes = 0;
+    uint32_t typeSpots[3] = {}; // spots per SpotType (room for its free-list)
+    uint32_t freeSpots[3] = {};
+    uint32_t totalSpots[3] = {}; // enabled ones
+    uint64_t blockBytes = 0;     // header + columns
+
+    // byte offsets from the start of the block, every column 8-byte aligned
+    struct Columns
+    {
+        uint64_t occupancy, typeMasks[3], freeSpots[3], spotIds, distances, freePos, idOffsets, spotTypes, idBytes, end;
+    };
+
+    Columns columns() const
+    {
+        Columns at;
+        uint64_t next = sizeof(SpotMapFloor);
+        auto take = [&](uint64_t size)
+        {
+            uint64_t start = next;
+            next += (size + 7) & ~uint64_t(7);
+            return start;
+        };
+        at.occupancy = take(uint64_t(words) * 8);
+        for (int t = 0; t < 3; t++)
+            at.typeMasks[t] = take(uint64_t(words) * 8);
+        for (int t = 0; t < 3; t++)
+            at.freeSpots[t] = take(uint64_t(typeSpots[t]) * 4);
+        at.spotIds = take(uint64_t(spotCount) * 4);
+        at.distances = take(uint64_t(spotCount) * 4);
+        at.freePos = take(uint64_t(spotCount) * 4);
+        at.idOffsets = take((uint64_t(idCount) + 1) * 4);
+        at.spotTypes = take(spotCount);
+        at.idBytes = take(idBytes);
+        at.end = next;
+        return at;
+    }
+
+    // sizes agree with each other and the block fits in what is left of the file (contents trusted)
+    bool fits(uint64_t available) const
+    {
+        uint64_t spots = 0;
+        for (int t = 0; t < 3; t++)
+        {
+            if (freeSpots[t] > typeSpots[t] or totalSpots[t] > typeSpots[t])
+                return false;
+            spots += typeSpots[t];
+        }
+        return spots == spotCount and (uint64_t(spotCount) + 63) / 64 <= words and
+               blockBytes == columns().end and blockBytes <= available;
+    }
 };
 
-// isolated and extensible
-class HourlyPricingStrategy : public PricingStrategy
+static_assert(sizeof(SpotMapFloor) == 64, "spot map floor header is part of the file format");
+static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t) and atomic<uint64_t>::is_always_lock_free,
+              "occupancy words are used in place in a mapped file");
+
+// A spot map file mapped copy-on-write: floors write into its pages (occupancy, free-lists) but
+// never back to the file. Shared by the floors it was loaded into, unmapped with the last one.
+class SpotMapFile
 {
+private:
+    char *base = nullptr;
+    size_t length = 0;
+
 public:
-    double calculatePrice(time_t entry, time_t exit, VehicleType type) override
+    explicit SpotMapFile(const string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 and info.st_size > 0)
+        {
+            void *region = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (region != MAP_FAILED)
+            {
+                base = static_cast<char *>(region);
+                length = info.st_size;
+            }
+        }
+        ::close(fd);
+    }
+
+    ~SpotMapFile()
+    {
+        if (base)
+            munmap(base, length);
+    }
+
+    SpotMapFile(const SpotMapFile &) = delete;
+    SpotMapFile &operator=(const SpotMapFile &) = delete;
+
+    bool isOpen() const
+    {
+        return base != nullptr;
+    }
+
+    char *data() const
+    {
+        return base;
+    }
+
+    size_t size() const
     {
-        double hours = difftime(exit, entry) / 3600.0;
-        double rate = 20.0;
-        if (type == VehicleType::TRUCK)
-            rate = 40;
-        else if (type == VehicleType::BIKE)
-            rate = 10;
-        return ceil(hours) * rate;
+        return length;
     }
 };
 
-// Payment Strategy
-class PaymentMethod
+// Hot-path instrumentation: latency histograms, lock wait/hold, floors scanned per park.
+// Build with -DPARKING_METRICS=0 and every hook below becomes an empty inline function or a plain
+// lock: zero cost, nothing left in the binary.
+#ifndef PARKING_METRICS
+#define PARKING_METRICS 1
+#endif
+
+enum class Histogram
 {
-public:
-    virtual bool pay(double amount) = 0;
-    virtual ~PaymentMethod() = default;
+    PARK_NS,
+    UNPARK_NS,
+    FLOOR_LOCK_WAIT_NS, // contended acquisitions only
+    FLOOR_LOCK_HOLD_NS, // sampled, 1 in 16 acquisitions
+    TICKETS_LOCK_WAIT_NS,
+    TICKETS_LOCK_HOLD_NS,
+    FLOORS_SCANNED, // per allocation
+    COUNT
 };
 
-class UPIPayment : public PaymentMethod
+enum class Counter
 {
-public:
-    bool pay(double amount) override
+    FLOOR_LOCKS,
+    FLOOR_LOCKS_CONTENDED,
+    TICKETS_LOCKS,
+    TICKETS_LOCKS_CONTENDED,
+    COUNT
+};
+
+enum class LockSite
+{
+    FLOOR,
+    TICKETS
+};
+
+struct HistogramSnapshot
+{
+    string name;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t p50 = 0, p90 = 0, p99 = 0, p999 = 0;
+};
+
+struct MetricsSnapshot
+{
+    bool enabled = false;
+    vector<HistogramSnapshot> histograms;
+    vector<pair<string, uint64_t>> counters;
+
+    void print(ostream &out) const
     {
-        cout << "Paid " << amount << " via UPI\n";
-        return true;
+        if (!enabled)
+        {
+            out << "  metrics compiled out (PARKING_METRICS=0)\n";
+            return;
+        }
+        for (const auto &h : histograms)
+        {
+            out << "  " << h.name << ": n=" << h.count;
+            if (h.count)
+                out << " mean=" << h.sum / h.count << " p50=" << h.p50 << " p90=" << h.p90
+                    << " p99=" << h.p99 << " p99.9=" << h.p999 << " max=" << h.max;
+            out << "\n";
+        }
+        for (const auto &c : counters)
+            out << "  " << c.first << ": " << c.second << "\n";
     }
 };
 
-// ParkingLot coordinates, doesn’t own logic, concurrency handel via mutex
-class ParkingLot
+#if PARKING_METRICS
+
+// Process-wide. Every thread writes only its own shard (plain relaxed load + store, no lock prefix,
+// no shared cache lines); snapshot() adds the shards up. Shards of finished threads are kept.
+// Histograms are log-linear (HDR-style): 8 sub-buckets per power of two, <= 12.5% error, 0..2^64.
+class ParkingMetrics
 {
 private:
-    vector<unique_ptr<ParkingFloor>> floors;
-    unique_ptr<PricingStrategy> pricingStrategy;
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+    static const int HISTOGRAMS = static_cast<int>(Histogram::COUNT);
+    static const int COUNTERS = static_cast<int>(Counter::COUNT);
 
-    // ParkingLot OWNS all active tickets
-    unordered_map<string, unique_ptr<Ticket>> activeTickets;
+    struct Shard
+    {
+        atomic<uint64_t> buckets[HISTOGRAMS][BUCKETS] = {};
+        atomic<uint64_t> sums[HISTOGRAMS] = {};
+        atomic<uint64_t> maxima[HISTOGRAMS] = {};
+        atomic<uint64_t> counters[COUNTERS] = {};
+    };
 
-    int ticketNumber = 1;
-    mutex mtx;
+    static mutex &registryMtx()
+    {
+        static mutex m;
+        return m;
+    }
 
-public:
-    ParkingLot(unique_ptr<PricingStrategy> strategy)
-        : pricingStrategy(move(strategy)) {}
+    static vector<unique_ptr<Shard>> &shards()
+    {
+        static vector<unique_ptr<Shard>> all;
+        return all;
+    }
 
-    void addFloor(unique_ptr<ParkingFloor> floor)
+    static Shard &local()
     {
-        floors.push_back(move(floor));
+        thread_local Shard *shard = []()
+        {
+            lock_guard<mutex> lock(registryMtx());
+            shards().push_back(make_unique<Shard>());
+            return shards().back().get();
+        }();
+        return *shard;
     }
 
-    // ✅ Returns ticketId, not Ticket*
-    string parkVehicle(shared_ptr<Vehicle> vehicle)
+    // single writer per shard
+    static void bump(atomic<uint64_t> &value, uint64_t n)
     {
-        lock_guard<mutex> lock(mtx);
+        value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+    }
+
+    static int bucketOf(uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+            return static_cast<int>(value);
+        int msb = 63 - __builtin_clzll(value);
+        return ((msb - SUB_BITS + 1) << SUB_BITS) + static_cast<int>((value >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+    }
+
+    // middle of the bucket's range
+    static uint64_t valueOf(int bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+            return bucket;
+        int msb = (bucket >> SUB_BITS) + SUB_BITS - 1;
+        uint64_t low = static_cast<uint64_t>(SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << (msb - SUB_BITS);
+        return low + (uint64_t(1) << (msb - SUB_BITS)) / 2;
+    }
 
-        for (auto &floor : floors)
+    static uint64_t steadyNs()
+    {
+        return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // ticks of now() per ns, measured once against steady_clock
+    static double nsPerTick()
+    {
+        static const double ratio = []()
         {
-            ParkingSpot *spot =
-                floor->findAvailableSpot(vehicle->getType());
+            uint64_t ns0 = steadyNs(), t0 = now();
+            this_thread::sleep_for(chrono::milliseconds(20));
+            uint64_t ns1 = steadyNs(), t1 = now();
+            return t1 > t0 ? static_cast<double>(ns1 - ns0) / (t1 - t0) : 1.0;
+        }();
+        return ratio;
+    }
 
-            if (spot)
-            {
-                spot->parkVehicle(vehicle);
+public:
+    // Time source of the histograms: the cycle counter where there is one (a few ns to read, vs ~20
+    // for the vDSO clock); converted to ns only in snapshot()
+    static uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_ia32_rdtsc();
+#else
+        return steadyNs();
+#endif
+    }
+
+    static void record(Histogram histogram, uint64_t value)
+    {
+        Shard &shard = local();
+        int h = static_cast<int>(histogram);
+        bump(shard.buckets[h][bucketOf(value)], 1);
+        bump(shard.sums[h], value);
+        if (value > shard.maxima[h].load(memory_order_relaxed))
+            shard.maxima[h].store(value, memory_order_relaxed);
+    }
 
-                string ticketId = "TICKET_" + to_string(ticketNumber++);
-                activeTickets[ticketId] =
-                    make_unique<Ticket>(ticketId, vehicle, spot);
+    static void count(Counter counter, uint64_t n = 1)
+    {
+        bump(local().counters[static_cast<int>(counter)], n);
+    }
 
-                return ticketId;
+    static MetricsSnapshot snapshot()
+    {
+        static const char *HISTOGRAM_NAMES[HISTOGRAMS] = {"park ns", "unpark ns", "floor lock wait ns", "floor lock hold ns (sampled)",
+                                                          "tickets lock wait ns", "tickets lock hold ns (sampled)", "floors scanned per park"};
+        static const char *COUNTER_NAMES[COUNTERS] = {"floor locks", "floor locks contended", "tickets locks", "tickets locks contended"};
+        MetricsSnapshot snapshot;
+        snapshot.enabled = true;
+#if defined(__x86_64__) || defined(__i386__)
+        double scale = nsPerTick();
+#else
+        double scale = 1.0;
+#endif
+        lock_guard<mutex> lock(registryMtx());
+        for (int h = 0; h < HISTOGRAMS; h++)
+        {
+            vector<uint64_t> buckets(BUCKETS, 0);
+            HistogramSnapshot result;
+            result.name = HISTOGRAM_NAMES[h];
+            for (auto &shard : shards())
+            {
+                for (int b = 0; b < BUCKETS; b++)
+                    buckets[b] += shard->buckets[h][b].load(memory_order_relaxed);
+                result.sum += shard->sums[h].load(memory_order_relaxed);
+                result.max = max(result.max, shard->maxima[h].load(memory_order_relaxed));
+            }
+            for (uint64_t n : buckets)
+                result.count += n;
+            uint64_t *targets[4] = {&result.p50, &result.p90, &result.p99, &result.p999};
+            double quantiles[4] = {0.5, 0.9, 0.99, 0.999};
+            uint64_t seen = 0;
+            int q = 0;
+            for (int b = 0; b < BUCKETS and q < 4 and result.count; b++)
+            {
+                seen += buckets[b];
+                while (q < 4 and seen >= quantiles[q] * result.count)
+                    *targets[q++] = min(valueOf(b), result.max);
+            }
+            if (h != static_cast<int>(Histogram::FLOORS_SCANNED))
+            {
+                for (uint64_t *value : {&result.sum, &result.max, &result.p50, &result.p90, &result.p99, &result.p999})
+                    *value = static_cast<uint64_t>(*value * scale);
             }
+            snapshot.histograms.push_back(result);
+        }
+        for (int c = 0; c < COUNTERS; c++)
+        {
+            uint64_t total = 0;
+            for (auto &shard : shards())
+                total += shard->counters[c].load(memory_order_relaxed);
+            snapshot.counters.push_back({COUNTER_NAMES[c], total});
         }
-        return ""; // parking lot full
+        return snapshot;
     }
 
-    double unparkVehicle(const string &ticketId,
-                         PaymentMethod &payment)
+    // zero everything, e.g. between benchmark phases; updates racing with it may survive
+    static void reset()
     {
-        lock_guard<mutex> lock(mtx);
-
-        auto it = activeTickets.find(ticketId);
-        if (it == activeTickets.end())
+        lock_guard<mutex> lock(registryMtx());
+        for (auto &shard : shards())
         {
-            return 0.0; // invalid ticket
+            for (auto &histogram : shard->buckets)
+                for (auto &bucket : histogram)
+                    bucket.store(0, memory_order_relaxed);
+            for (int h = 0; h < HISTOGRAMS; h++)
+            {
+                shard->sums[h].store(0, memory_order_relaxed);
+                shard->maxima[h].store(0, memory_order_relaxed);
+            }
+            for (auto &counter : shard->counters)
+                counter.store(0, memory_order_relaxed);
         }
+    }
+};
 
-        // Extract ownership
-        unique_ptr<Ticket> ticket = move(it->second);
-        activeTickets.erase(it);
-
-        // Close ticket
-        ticket->closeTicket();
+// scoped: records the lifetime of the object into a latency histogram
+class OpTimer
+{
+private:
+    Histogram histogram;
+    uint64_t start;
 
-        // 🔥 CRUCIAL: free the spot
-        ticket->getParkingSpot()->removeVehicle();
+public:
+    explicit OpTimer(Histogram h) : histogram(h), start(ParkingMetrics::now()) {}
 
-        // Calculate price
-        double amount = pricingStrategy->calculatePrice(
-            ticket->getEntryTime(),
-            ticket->getExitTime(),
-            ticket->getVehicleType());
+    ~OpTimer()
+    {
+        ParkingMetrics::record(histogram, ParkingMetrics::now() - start);
+    }
+};
 
-        payment.pay(amount);
+// scoped: floors an allocation looked at
+struct ScanLength
+{
+    uint64_t floors = 0;
 
-        // ticket destroyed here automatically
-        return amount;
+    ~ScanLength()
+    {
+        ParkingMetrics::record(Histogram::FLOORS_SCANNED, floors);
     }
 };
 
-int main()
+// lock_guard that feeds the lock counters: only a contended acquisition reads the clock for the
+// wait, hold time is sampled on 1 in 16 acquisitions
+class MeteredLock
 {
+private:
+    mutex &mtx;
+    LockSite site;
+    bool owns = false;
+    uint64_t holdStart = 0;
 
-    // Use unique_ptr when:
-    // There is exactly ONE owner
-    // 🔹 Use shared_ptr when:
-    // Multiple objects need to refer to it safely
+    Histogram waitHistogram() const
+    {
+        return site == LockSite::FLOOR ? Histogram::FLOOR_LOCK_WAIT_NS : Histogram::TICKETS_LOCK_WAIT_NS;
+    }
 
-    // 1. create parking lot with floors, spots, and pricing strategy.
+    // sampled at random, a fixed every-16th would always hit the same call site of a gate's cycle
+    void acquired()
+    {
+        owns = true;
+        thread_local uint32_t state = 2463534242u;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        if ((state & 15) == 0)
+            holdStart = ParkingMetrics::now();
+    }
+
+    void countAttempt(bool contended)
+    {
+        ParkingMetrics::count(site == LockSite::FLOOR ? Counter::FLOOR_LOCKS : Counter::TICKETS_LOCKS);
+        if (contended)
+            ParkingMetrics::count(site == LockSite::FLOOR ? Counter::FLOOR_LOCKS_CONTENDED : Counter::TICKETS_LOCKS_CONTENDED);
+    }
+
+public:
+    MeteredLock(mutex &m, LockSite s) : mtx(m), site(s)
+    {
+        bool contended = !mtx.try_lock();
+        countAttempt(contended);
+        if (contended)
+        {
+            uint64_t waitStart = ParkingMetrics::now();
+            mtx.lock();
+            ParkingMetrics::record(waitHistogram(), ParkingMetrics::now() - waitStart);
+        }
+        acquired();
+    }
+
+    // like unique_lock(m, try_to_lock): a failed try counts as contended, without waiting
+    MeteredLock(mutex &m, LockSite s, try_to_lock_t) : mtx(m), site(s)
+    {
+        bool locked = mtx.try_lock();
+        countAttempt(!locked);
+        if (locked)
+            acquired();
+    }
+
+    MeteredLock(const MeteredLock &) = delete;
+    MeteredLock &operator=(const MeteredLock &) = delete;
+
+    ~MeteredLock()
+    {
+        if (!owns)
+            return;
+        uint64_t held = holdStart ? ParkingMetrics::now() - holdStart : 0;
+        mtx.unlock();
+        if (holdStart)
+            ParkingMetrics::record(site == LockSite::FLOOR ? Histogram::FLOOR_LOCK_HOLD_NS : Histogram::TICKETS_LOCK_HOLD_NS, held);
+    }
+
+    bool owns_lock() const
+    {
+        return owns;
+    }
+};
+
+#else
+
+class ParkingMetrics
+{
+public:
+    static void record(Histogram, uint64_t) {}
+    static void count(Counter, uint64_t = 1) {}
+    static MetricsSnapshot snapshot()
+    {
+        return MetricsSnapshot();
+    }
+    static void reset() {}
+};
+
+class OpTimer
+{
+public:
+    explicit OpTimer(Histogram) {}
+};
+
+struct ScanLength
+{
+    uint64_t floors = 0;
+};
+
+class MeteredLock
+{
+private:
+    mutex &mtx;
+    bool owns;
+
+public:
+    MeteredLock(mutex &m, LockSite) : mtx(m), owns(true)
+    {
+        mtx.lock();
+    }
+    MeteredLock(mutex &m, LockSite, try_to_lock_t) : mtx(m), owns(m.try_lock()) {}
+    MeteredLock(const MeteredLock &) = delete;
+    MeteredLock &operator=(const MeteredLock &) = delete;
+    ~MeteredLock()
+    {
+        if (owns)
+            mtx.unlock();
+    }
+    bool owns_lock() const
+    {
+        return owns;
+    }
+};
+
+#endif
+
+// Told about every spot taken, freed or added on a floor, from under the floor's lock: keep it cheap.
+class OccupancyObserver
+{
+public:
+    virtual void occupancyChanged(SpotType type, int occupiedDelta, int capacityDelta) = 0;
+    virtual ~OccupancyObserver() = default;
+};
+
+// Spots are stored as a structure of arrays (type, interned id, vehicle per index + occupancy and
+// per-type bitsets), so occupancy scans and counts walk a few contiguous words instead of chasing
+// one heap object per spot. ParkingSpot is only the description handed to addSpot.
+// Free spots are indexed per SpotType, so finding a spot never walks the floor.
+// Smallest fitting type is tried first -> a car doesn't take a truck spot while car spots are free.
+class ParkingFloor
+{
+private:
+    static const int SPOT_TYPES = 3;
+    static const uint32_t WORD_BITS = 64;
+    static constexpr uint32_t NO_SPOT = UINT32_MAX;
+
+    int floorNumber;
+
+    // Columns are heap arrays for a floor built spot by spot, or point into a spot map file
+    // (mapping keeps it alive) for a floor loaded from one -> nothing is parsed or copied at startup.
+    shared_ptr<SpotMapFile> mapping;
+
+    // one entry per spot, spot index = position
+    Column<SpotType> spotTypes;
+    Column<uint32_t> spotIds;   // into spotIdPool (which vehicle is where lives in the lot's tickets)
+    Column<uint32_t> distances; // walking distance to the entrance, for NearestToEntrancePolicy
+    Column<uint32_t> freePos;   // position of the spot in its free-list, NO_SPOT when taken
+    StringPool spotIdPool;
+
+    // bitsets, bit i = spot i
+    Column<uint64_t> typeMasks[SPOT_TYPES];
+    // Set and cleared only under mtx (claims are serialized by the floor lock, not raced); the words are
+    // atomic for the lock-free readers such as isOccupied(). Grows by doubling while the lot
+    // is open: those readers don't take the lock, so outgrown arrays are kept until the floor
+    // goes away (at most as many words again as the current array). A mapped floor starts on the
+    // words in the file.
+    atomic<atomic<uint64_t> *> occupancy{nullptr};
+    vector<unique_ptr<atomic<uint64_t>[]>> occupancyArrays;
+    size_t occupancyWords = 0; // allocated words of the current array
+
+    Column<uint32_t> freeSpots[SPOT_TYPES]; // free-list (stack) per SpotType, index = static_cast<int>(SpotType)
+    mutex mtx;                              // per floor, gates on different floors never wait on each other
+
+    // free spots ordered by distance, only kept when a policy asks for it (costs O(log n) per park/unpark)
+    bool distanceIndex = false;
+    set<pair<uint32_t, uint32_t>> freeByDistance[SPOT_TYPES]; // (distance, spot index)
+
+    // Counters for dashboards, kept in step with the free-lists (writers hold mtx).
+    // Readers never lock: a seqlock gives them a consistent copy, odd sequence = write in progress.
+    atomic<uint32_t> freeCount[SPOT_TYPES] = {};
+    atomic<uint32_t> totalCount[SPOT_TYPES] = {};
+    atomic<uint64_t> countersSeq{0};
+
+    OccupancyObserver *observer = nullptr; // e.g. a pricing engine following live occupancy
+
+    void notify(SpotType type, int occupiedDelta, int capacityDelta)
+    {
+        if (observer)
+            observer->occupancyChanged(type, occupiedDelta, capacityDelta);
+    }
+
+    void beginCounterWrite()
+    {
+        countersSeq.store(countersSeq.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+
+    void endCounterWrite()
+    {
+        countersSeq.store(countersSeq.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    void addToCounter(atomic<uint32_t> &counter, int delta)
+    {
+        counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+    }
+
+    static uint64_t bitOf(uint32_t index)
+    {
+        return 1ULL << (index % WORD_BITS);
+    }
+
+    size_t usedWords() const
+    {
+        return (spotTypes.size() + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    atomic<uint64_t> &occupancyWord(size_t word) const
+    {
+        return occupancy.load(memory_order_acquire)[word];
+    }
+
+    // disabled spots are taken out of their type mask (and so out of every count and scan)
+    bool isEnabled(uint32_t index) const
+    {
+        return typeMasks[static_cast<int>(spotTypes[index])][index / WORD_BITS] & bitOf(index);
+    }
+
+    // 0 -> 1, caller holds mtx; false means the bit was already set (free-list out of step)
+    bool tryClaim(uint32_t index)
+    {
+        uint64_t bit = bitOf(index);
+        return !(occupancyWord(index / WORD_BITS).fetch_or(bit, memory_order_acq_rel) & bit);
+    }
+
+    void pushFree(uint32_t index)
+    {
+        int t = static_cast<int>(spotTypes[index]);
+        freePos[index] = static_cast<uint32_t>(freeSpots[t].size());
+        freeSpots[t].push_back(index);
+        if (distanceIndex)
+            freeByDistance[t].insert({distances[index], index});
+    }
+
+    // O(1) from any position: the last entry takes its place
+    void eraseFree(uint32_t index)
+    {
+        int t = static_cast<int>(spotTypes[index]);
+        uint32_t pos = freePos[index];
+        uint32_t last = freeSpots[t].back();
+        freeSpots[t][pos] = last;
+        freePos[last] = pos;
+        freeSpots[t].pop_back();
+        freePos[index] = NO_SPOT;
+        if (distanceIndex)
+            freeByDistance[t].erase({distances[index], index});
+    }
+
+    // index must be on a free-list, caller holds mtx
+    uint32_t claimIndex(uint32_t index)
+    {
+        eraseFree(index);
+        if (!tryClaim(index)) // never fails: every claim goes through the free-lists under mtx
+            return NO_SPOT;
+        beginCounterWrite();
+        addToCounter(freeCount[static_cast<int>(spotTypes[index])], -1);
+        endCounterWrite();
+        notify(spotTypes[index], +1, 0);
+        return index;
+    }
+
+    uint32_t claimFreeSpot(VehicleType type)
+    {
+        for (int t = static_cast<int>(type); t < SPOT_TYPES; t++)
+        {
+            while (!freeSpots[t].empty())
+            {
+                uint32_t index = claimIndex(freeSpots[t].back());
+                if (index != NO_SPOT)
+                    return index;
+            }
+        }
+        return NO_SPOT;
+    }
+
+    void releaseSpot(uint32_t index)
+    {
+        occupancyWord(index / WORD_BITS).fetch_and(~bitOf(index), memory_order_release);
+        notify(spotTypes[index], -1, 0);
+        if (!isEnabled(index))
+            return; // disabled while the vehicle was in it: stays off the free-list
+        pushFree(index);
+        beginCounterWrite();
+        addToCounter(freeCount[static_cast<int>(spotTypes[index])], +1);
+        endCounterWrite();
+    }
+
+    SpotView viewOf(uint32_t index)
+    {
+        return index == NO_SPOT ? SpotView() : SpotView(this, index);
+    }
+
+    // bits of every spot type a vehicle of this type fits in
+    uint64_t fitMask(VehicleType type, size_t word) const
+    {
+        uint64_t mask = 0;
+        for (int t = static_cast<int>(type); t < SPOT_TYPES; t++)
+            mask |= typeMasks[t][word];
+        return mask;
+    }
+
+public:
+    ParkingFloor(int number) : floorNumber(number) {}
+
+    // Floor working in place on its block of a mapped spot map (validated by the caller with
+    // SpotMapFloor::fits). O(1): spots are only touched when a gate gets to them.
+    ParkingFloor(shared_ptr<SpotMapFile> file, size_t offset) : mapping(move(file))
+    {
+        char *block = mapping->data() + offset;
+        SpotMapFloor header;
+        memcpy(&header, block, sizeof(header));
+        SpotMapFloor::Columns at = header.columns();
+        floorNumber = header.floorNumber;
+
+        spotTypes.map(block + at.spotTypes, header.spotCount, header.spotCount);
+        spotIds.map(block + at.spotIds, header.spotCount, header.spotCount);
+        distances.map(block + at.distances, header.spotCount, header.spotCount);
+        freePos.map(block + at.freePos, header.spotCount, header.spotCount);
+        spotIdPool.map(block + at.idOffsets, header.idCount, block + at.idBytes, header.idBytes);
+        for (int t = 0; t < SPOT_TYPES; t++)
+        {
+            typeMasks[t].map(block + at.typeMasks[t], header.words, header.words);
+            freeSpots[t].map(block + at.freeSpots[t], header.freeSpots[t], header.typeSpots[t]);
+            freeCount[t].store(header.freeSpots[t], memory_order_relaxed);
+            totalCount[t].store(header.totalSpots[t], memory_order_relaxed);
+        }
+        occupancy.store(reinterpret_cast<atomic<uint64_t> *>(block + at.occupancy), memory_order_release);
+        occupancyWords = header.words;
+    }
+
+    // Appends this floor's block of a spot map (ids, types, distances, enabled spots, free-lists).
+    // Only for a floor nobody is parked on: false, and nothing appended, otherwise.
+    bool appendLayout(string &out)
+    {
+        lock_guard<mutex> lock(mtx);
+        size_t words = usedWords();
+        for (size_t w = 0; w < words; w++)
+        {
+            if (occupancyWord(w).load(memory_order_relaxed))
+                return false;
+        }
+        SpotMapFloor header;
+        header.floorNumber = floorNumber;
+        header.spotCount = static_cast<uint32_t>(spotTypes.size());
+        header.words = static_cast<uint32_t>(words);
+        header.idCount = spotIdPool.size();
+        header.idBytes = spotIdPool.byteSize();
+        for (SpotType type : spotTypes)
+            header.typeSpots[static_cast<int>(type)]++;
+        for (int t = 0; t < SPOT_TYPES; t++)
+        {
+            header.freeSpots[t] = static_cast<uint32_t>(freeSpots[t].size());
+            header.totalSpots[t] = totalCount[t].load(memory_order_relaxed);
+        }
+        SpotMapFloor::Columns at = header.columns();
+        header.blockBytes = at.end;
+
+        size_t start = out.size();
+        out.resize(start + at.end, '\0'); // padding and the (empty) occupancy words stay zero
+        char *block = &out[start];
+        auto put = [&](uint64_t position, const void *from, size_t bytes)
+        {
+            if (bytes)
+                memcpy(block + position, from, bytes);
+        };
+        put(0, &header, sizeof(header));
+        for (int t = 0; t < SPOT_TYPES; t++)
+        {
+            put(at.typeMasks[t], typeMasks[t].data(), words * sizeof(uint64_t));
+            put(at.freeSpots[t], freeSpots[t].data(), freeSpots[t].size() * sizeof(uint32_t));
+        }
+        put(at.spotIds, spotIds.data(), spotIds.size() * sizeof(uint32_t));
+        put(at.distances, distances.data(), distances.size() * sizeof(uint32_t));
+        put(at.freePos, freePos.data(), freePos.size() * sizeof(uint32_t));
+        put(at.idOffsets, spotIdPool.offsetData(), (header.idCount + 1) * sizeof(uint32_t));
+        put(at.spotTypes, spotTypes.data(), spotTypes.size());
+        put(at.idBytes, spotIdPool.byteData(), header.idBytes);
+        return true;
+    }
+
+    // distance: how far the spot is from the entrance (any unit, compared across floors)
+    void addSpot(const string &id, SpotType type, uint32_t distance = 0)
+    {
+        lock_guard<mutex> lock(mtx);
+        uint32_t index = static_cast<uint32_t>(spotTypes.size());
+        spotTypes.push_back(type);
+        spotIds.push_back(spotIdPool.intern(id));
+        distances.push_back(distance);
+        freePos.push_back(NO_SPOT);
+
+        if (usedWords() > typeMasks[0].size())
+        {
+            for (auto &mask : typeMasks)
+                mask.push_back(0);
+        }
+        typeMasks[static_cast<int>(type)][index / WORD_BITS] |= bitOf(index);
+
+        if (usedWords() > occupancyWords)
+        {
+            size_t grown = max<size_t>(4, occupancyWords * 2);
+            unique_ptr<atomic<uint64_t>[]> words(new atomic<uint64_t>[grown]);
+            for (size_t w = 0; w < grown; w++)
+                words[w].store(w < occupancyWords ? occupancyWord(w).load() : 0);
+            occupancy.store(words.get(), memory_order_release);
+            occupancyArrays.push_back(move(words));
+            occupancyWords = grown;
+        }
+        pushFree(index);
+        beginCounterWrite();
+        addToCounter(freeCount[static_cast<int>(type)], +1);
+        addToCounter(totalCount[static_cast<int>(type)], +1);
+        endCounterWrite();
+        notify(type, 0, +1);
+    }
+
+    // the ParkingSpot object is only read for its id and type
+    void addSpot(unique_ptr<ParkingSpot> spot)
+    {
+        addSpot(spot->getSpotId(), spot->getType());
+    }
+
+    int getFloorNumber() const
+    {
+        return floorNumber;
+    }
+
+    // The observer first hears about the spots already on this floor, then about every change.
+    // A replaced observer (or nullptr, e.g. floor taken offline) is told they are gone.
+    void setOccupancyObserver(OccupancyObserver *newObserver)
+    {
+        lock_guard<mutex> lock(mtx);
+        int occupied[SPOT_TYPES] = {}, capacity[SPOT_TYPES] = {};
+        for (uint32_t index = 0; index < spotTypes.size(); index++)
+        {
+            int t = static_cast<int>(spotTypes[index]);
+            occupied[t] += isOccupied(index);
+            capacity[t] += isEnabled(index);
+        }
+        for (int t = 0; t < SPOT_TYPES; t++)
+            notify(static_cast<SpotType>(t), -occupied[t], -capacity[t]);
+        observer = newObserver;
+        for (int t = 0; t < SPOT_TYPES; t++)
+            notify(static_cast<SpotType>(t), occupied[t], capacity[t]);
+    }
+
+    // Online maintenance of a single spot. A disabled spot is never handed out again; a vehicle in it
+    // stays (its ticket is untouched) and the spot just isn't freed for reuse when it leaves.
+    // Spots are never erased: tickets, the journal and snapshots address them by index.
+    bool setSpotEnabled(uint32_t index, bool enabled)
+    {
+        lock_guard<mutex> lock(mtx);
+        if (index >= spotTypes.size())
+            return false;
+        if (isEnabled(index) == enabled)
+            return true;
+        int t = static_cast<int>(spotTypes[index]);
+        bool free = !isOccupied(index);
+        typeMasks[t][index / WORD_BITS] ^= bitOf(index);
+        if (free)
+        {
+            if (enabled)
+                pushFree(index);
+            else
+                eraseFree(index);
+        }
+        beginCounterWrite();
+        if (free)
+            addToCounter(freeCount[t], enabled ? +1 : -1);
+        addToCounter(totalCount[t], enabled ? +1 : -1);
+        endCounterWrite();
+        notify(spotTypes[index], 0, enabled ? +1 : -1);
+        return true;
+    }
+
+    bool isSpotEnabled(uint32_t index)
+    {
+        lock_guard<mutex> lock(mtx);
+        return index < spotTypes.size() and isEnabled(index);
+    }
+
+    // turn on the distance-ordered free index (NearestToEntrancePolicy)
+    void enableDistanceIndex()
+    {
+        lock_guard<mutex> lock(mtx);
+        if (distanceIndex)
+            return;
+        distanceIndex = true;
+        for (int t = 0; t < SPOT_TYPES; t++)
+        {
+            for (uint32_t index : freeSpots[t])
+                freeByDistance[t].insert({distances[index], index});
+        }
+    }
+
+    // lock-free, may be stale by the time the caller acts on it
+    uint32_t getFreeCount(SpotType type) const
+    {
+        return freeCount[static_cast<int>(type)].load(memory_order_relaxed);
+    }
+
+    // distance of the nearest free spot of exactly this type, UINT32_MAX if none (needs the distance index)
+    uint32_t nearestFreeDistance(SpotType type)
+    {
+        lock_guard<mutex> lock(mtx);
+        const auto &byDistance = freeByDistance[static_cast<int>(type)];
+        return byDistance.empty() ? UINT32_MAX : byDistance.begin()->first;
+    }
+
+    size_t getSpotCount()
+    {
+        lock_guard<mutex> lock(mtx);
+        return spotTypes.size();
+    }
+
+    SpotType getSpotType(uint32_t index)
+    {
+        lock_guard<mutex> lock(mtx);
+        return spotTypes[index];
+    }
+
+    string getSpotId(uint32_t index)
+    {
+        lock_guard<mutex> lock(mtx);
+        return string(spotIdPool.get(spotIds[index]));
+    }
+
+    bool isOccupied(uint32_t index) const
+    {
+        return occupancyWord(index / WORD_BITS).load(memory_order_acquire) & bitOf(index);
+    }
+
+    // O(1): top of the free-list of the smallest type that fits
+    SpotView findAvailableSpot(VehicleType type)
+    {
+        lock_guard<mutex> lock(mtx);
+        for (int t = static_cast<int>(type); t < SPOT_TYPES; t++)
+        {
+            if (!freeSpots[t].empty())
+                return SpotView(this, freeSpots[t].back());
+        }
+        return SpotView();
+    }
+
+    // O(n) scan, kept only to compare against in the benchmark (64 spots per step on the bitsets)
+    SpotView findAvailableSpotLinear(VehicleType type)
+    {
+        lock_guard<mutex> lock(mtx);
+        for (size_t w = 0; w < usedWords(); w++)
+        {
+            uint64_t free = ~occupancyWord(w).load(memory_order_relaxed) & fitMask(type, w);
+            if (free)
+                return SpotView(this, static_cast<uint32_t>(w * WORD_BITS + __builtin_ctzll(free)));
+        }
+        return SpotView();
+    }
+
+    // lock-free read of the counters, retried only while a gate is mid-update on this floor
+    FloorAvailability getAvailability() const
+    {
+        FloorAvailability snapshot;
+        snapshot.floorNumber = floorNumber;
+        while (true)
+        {
+            uint64_t before = countersSeq.load(memory_order_acquire);
+            if (before % 2 == 0)
+            {
+                for (int t = 0; t < SPOT_TYPES; t++)
+                {
+                    snapshot.freeSpots[t] = freeCount[t].load(memory_order_relaxed);
+                    snapshot.totalSpots[t] = totalCount[t].load(memory_order_relaxed);
+                }
+                atomic_thread_fence(memory_order_acquire);
+                if (countersSeq.load(memory_order_relaxed) == before)
+                    return snapshot;
+            }
+            this_thread::yield();
+        }
+    }
+
+    // popcount over the bitsets, no per-spot work
+    size_t countAvailable(SpotType type)
+    {
+        lock_guard<mutex> lock(mtx);
+        const Column<uint64_t> &mask = typeMasks[static_cast<int>(type)];
+        size_t count = 0;
+        for (size_t w = 0; w < usedWords(); w++)
+            count += __builtin_popcountll(~occupancyWord(w).load(memory_order_relaxed) & mask[w]);
+        return count;
+    }
+
+    size_t countOccupied()
+    {
+        lock_guard<mutex> lock(mtx);
+        size_t count = 0;
+        for (size_t w = 0; w < usedWords(); w++)
+            count += __builtin_popcountll(occupancyWord(w).load(memory_order_relaxed));
+        return count;
+    }
+
+    // find + occupy in one step, keeps the free-list in sync with the spots
+    SpotView parkVehicle(VehicleType type)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        return viewOf(claimFreeSpot(type));
+    }
+
+    // only spots of exactly this type (caller checked it fits)
+    SpotView parkVehicleInType(SpotType type)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        const Column<uint32_t> &list = freeSpots[static_cast<int>(type)];
+        return list.empty() ? SpotView() : viewOf(claimIndex(list.back()));
+    }
+
+    // nearest free spot of exactly this type, O(log n) (needs the distance index)
+    SpotView parkVehicleNearest(SpotType type)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        const auto &byDistance = freeByDistance[static_cast<int>(type)];
+        return byDistance.empty() ? SpotView() : viewOf(claimIndex(byDistance.begin()->second));
+    }
+
+    // same, but gives up instead of waiting when another gate holds this floor
+    SpotView tryParkVehicle(VehicleType type, bool &contended)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR, try_to_lock);
+        if (!lock.owns_lock())
+        {
+            contended = true;
+            return SpotView();
+        }
+        return viewOf(claimFreeSpot(type));
+    }
+
+    // batch: one lock for the whole batch, fills spots[i] for every vehicle still without a spot,
+    // returns how many got one here
+    size_t parkVehicles(const vector<Vehicle> &toPark, vector<SpotView> &spots)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        size_t parked = 0;
+        for (size_t i = 0; i < toPark.size(); i++)
+        {
+            if (spots[i])
+                continue;
+            uint32_t index = claimFreeSpot(toPark[i].getType());
+            if (index != NO_SPOT)
+            {
+                spots[i] = SpotView(this, index);
+                parked++;
+            }
+        }
+        return parked;
+    }
+
+    void removeVehicle(uint32_t index)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        releaseSpot(index);
+    }
+
+    // Recovery: occupy exactly these spots
+    void restoreVehicles(const vector<uint32_t> &parked)
+    {
+        lock_guard<mutex> lock(mtx);
+        for (uint32_t index : parked)
+        {
+            if (index >= spotTypes.size() or isOccupied(index))
+                continue; // layout changed or spot listed twice, keep the first
+            if (isEnabled(index))
+                claimIndex(index);
+            else if (tryClaim(index)) // disabled with the vehicle in it: off the free-list and the free count
+                notify(spotTypes[index], +1, 0);
+        }
+    }
+
+    void removeVehicles(const vector<uint32_t> &toFree)
+    {
+        MeteredLock lock(mtx, LockSite::FLOOR);
+        for (uint32_t index : toFree)
+            releaseSpot(index);
+    }
+};
+
+SpotType SpotView::getType() const
+{
+    return floor->getSpotType(index);
+}
+
+string SpotView::getSpotId() const
+{
+    return floor->getSpotId(index);
+}
+
+bool SpotView::isOccupied() const
+{
+    return floor->isOccupied(index);
+}
+
+// Time inside the lot: integer milliseconds since the Unix epoch. Sub-second billing, and still
+// meaningful after a restart (journal), which a boot-relative monotonic clock wouldn't be.
+using Ticks = int64_t;
+const Ticks TICKS_PER_SECOND = 1000;
+const Ticks TICKS_PER_HOUR = 3600 * TICKS_PER_SECOND;
+
+// Where ParkingLot gets "now" from. Injected so a simulation can run on virtual time.
+class Clock
+{
+public:
+    virtual Ticks now() = 0;
+    virtual ~Clock() = default;
+};
+
+// CLOCK_REALTIME_COARSE is served from the vDSO (no syscall), resolution a few ms
+class SystemClock : public Clock
+{
+public:
+    Ticks now() override
+    {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+        return static_cast<Ticks>(ts.tv_sec) * TICKS_PER_SECOND + ts.tv_nsec / 1000000;
+    }
+};
+
+// now() is a single atomic load. The value is refreshed explicitly (e.g. once per gate batch)
+// and/or by a background ticker every `period`.
+class CachedClock : public Clock
+{
+private:
+    shared_ptr<Clock> source;
+    atomic<Ticks> cached;
+    atomic<bool> stopping{false};
+    thread ticker;
+
+public:
+    explicit CachedClock(shared_ptr<Clock> src, chrono::milliseconds period = chrono::milliseconds(0))
+        : source(move(src)), cached(source->now())
+    {
+        if (period.count() > 0)
+        {
+            ticker = thread([this, period]()
+                            {
+                while (!stopping.load(memory_order_relaxed))
+                {
+                    this_thread::sleep_for(period);
+                    refresh();
+                } });
+        }
+    }
+
+    ~CachedClock()
+    {
+        stopping = true;
+        if (ticker.joinable())
+            ticker.join();
+    }
+
+    Ticks now() override
+    {
+        return cached.load(memory_order_relaxed);
+    }
+
+    void refresh()
+    {
+        cached.store(source->now(), memory_order_relaxed);
+    }
+};
+
+// moved by hand, e.g. by the simulator to the time of the event being processed
+class VirtualClock : public Clock
+{
+private:
+    atomic<Ticks> current;
+
+public:
+    explicit VirtualClock(Ticks start = 0) : current(start) {}
+
+    Ticks now() override
+    {
+        return current.load(memory_order_relaxed);
+    }
+
+    void set(Ticks t)
+    {
+        current.store(t, memory_order_relaxed);
+    }
+
+    void advance(Ticks ticks)
+    {
+        current.fetch_add(ticks, memory_order_relaxed);
+    }
+};
+
+// 64-bit ticket handle: | shard (8) | generation (24) | slot in the TicketTable (32) |
+// A stale handle (slot reused since) has the wrong generation and is rejected.
+// The shard bits are 0 inside a ParkingLot, ShardedParkingLot sets them to route the ticket back.
+using TicketId = uint64_t;
+const TicketId INVALID_TICKET = 0; // generations start at 1, so no live ticket is ever 0
+const uint32_t GENERATION_MASK = (1u << 24) - 1;
+const int SHARD_SHIFT = 56;
+
+uint32_t ticketSlot(TicketId id)
+{
+    return static_cast<uint32_t>(id);
+}
+
+uint32_t ticketGeneration(TicketId id)
+{
+    return static_cast<uint32_t>(id >> 32) & GENERATION_MASK;
+}
+
+uint32_t ticketShard(TicketId id)
+{
+    return static_cast<uint32_t>(id >> SHARD_SHIFT);
+}
+
+// string form only for printing / receipts, never used as a key
+string ticketToString(TicketId id)
+{
+    string text = "TICKET_";
+    if (ticketShard(id))
+        text += "S" + to_string(ticketShard(id)) + "_";
+    return text + to_string(ticketSlot(id)) + "_" + to_string(ticketGeneration(id));
+}
+
+class Ticket
+{
+private:
+    TicketId ticketId = INVALID_TICKET;
+    VehicleHandle vehicle = NO_VEHICLE; // into the lot's VehiclePool
+    VehicleType vehicleType = VehicleType::CAR; // kept here, pricing needs no pool lookup
+
+    /*
+     Why NOT shared_ptr<ParkingSpot>?
+        Ticket co-owns the spot ❌
+        Spot might live longer than floor ❌
+        Lifecycle becomes unclear ❌
+     -> a non-owning view (floor + index), the floor is needed anyway to put the spot back on its free-list
+    */
+    SpotView spot;
+    Ticks entryTime = 0;
+    Ticks exitTime = 0;
+
+public:
+    Ticket() = default; // empty slot in the TicketTable
+
+    // times come from the lot's Clock (or the journal when a ticket is rebuilt)
+    Ticket(TicketId id, VehicleHandle v, VehicleType type, SpotView s, Ticks entry)
+        : ticketId(id), vehicle(v), vehicleType(type), spot(s), entryTime(entry) {}
+
+    void closeTicket(Ticks exit)
+    {
+        exitTime = exit;
+    }
+    Ticks getEntryTime() const
+    {
+        return entryTime;
+    }
+
+    SpotView getParkingSpot() const
+    {
+        return spot;
+    }
+
+    Ticks getExitTime() const
+    {
+        return exitTime;
+    }
+
+    TicketId getTicketId() const
+    {
+        return ticketId;
+    }
+
+    VehicleType getVehicleType() const
+    {
+        return vehicleType;
+    }
+
+    VehicleHandle getVehicle() const
+    {
+        return vehicle;
+    }
+
+    // no destructor to delete spot, as spot is owned by ParkingFloor
+};
+
+// Slab of Ticket slots: tickets live in fixed-size chunks that are never moved or freed,
+// released slots go on a free-list and are reused -> no allocation per park once warmed up,
+// lookup is an index + generation check, no hashing.
+// Not thread-safe on its own, ParkingLot guards it.
+class TicketTable
+{
+private:
+    static const uint32_t CHUNK_SIZE = 1024;
+
+    struct Slot
+    {
+        uint32_t generation = 1;
+        bool inUse = false;
+        bool closing = false; // unpark waiting for its journal record, invisible to find()
+        Ticket ticket;
+    };
+
+    vector<unique_ptr<Slot[]>> chunks;
+    vector<uint32_t> freeSlots;
+    uint32_t slotCount = 0;
+    size_t active = 0;
+
+    Slot &slotAt(uint32_t index)
+    {
+        return chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    static TicketId makeId(uint32_t generation, uint32_t index)
+    {
+        return (static_cast<TicketId>(generation) << 32) | index;
+    }
+
+    void growTo(uint32_t count)
+    {
+        while (chunks.size() * CHUNK_SIZE < count)
+            chunks.push_back(make_unique<Slot[]>(CHUNK_SIZE));
+        slotCount = max(slotCount, count);
+    }
+
+    // slot of a live (open or closing) ticket, nullptr otherwise
+    Slot *slotOf(TicketId id)
+    {
+        uint32_t index = ticketSlot(id);
+        if (index >= slotCount)
+            return nullptr;
+        Slot &slot = slotAt(index);
+        if (!slot.inUse or slot.generation != ticketGeneration(id))
+            return nullptr;
+        return &slot;
+    }
+
+public:
+    TicketId open(VehicleHandle vehicle, VehicleType type, SpotView spot, Ticks entryTime)
+    {
+        uint32_t index;
+        if (!freeSlots.empty())
+        {
+            index = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        else
+        {
+            growTo(slotCount + 1);
+            index = slotCount - 1;
+        }
+        Slot &slot = slotAt(index);
+        TicketId id = makeId(slot.generation, index);
+        slot.inUse = true;
+        slot.ticket = Ticket(id, vehicle, type, spot, entryTime);
+        active++;
+        return id;
+    }
+
+    // nullptr for unknown, closing or already closed tickets
+    Ticket *find(TicketId id)
+    {
+        Slot *slot = slotOf(id);
+        return slot and !slot->closing ? &slot->ticket : nullptr;
+    }
+
+    // Two-step close for a journaled unpark: the ticket disappears for everyone else but keeps its slot
+    // until the record is durable, then release() or cancelClose() if it never made it.
+    Ticket *beginClose(TicketId id)
+    {
+        Slot *slot = slotOf(id);
+        if (!slot or slot->closing)
+            return nullptr;
+        slot->closing = true;
+        return &slot->ticket;
+    }
+
+    Ticket *findClosing(TicketId id)
+    {
+        Slot *slot = slotOf(id);
+        return slot and slot->closing ? &slot->ticket : nullptr;
+    }
+
+    void cancelClose(TicketId id)
+    {
+        if (Slot *slot = slotOf(id))
+            slot->closing = false;
+    }
+
+    // the handle becomes invalid, the slot is recycled
+    void release(TicketId id)
+    {
+        uint32_t index = ticketSlot(id);
+        Slot &slot = slotAt(index);
+        slot.ticket = Ticket();
+        slot.inUse = false;
+        slot.closing = false;
+        slot.generation = (slot.generation + 1) & GENERATION_MASK;
+        if (slot.generation == 0) // skip 0 so INVALID_TICKET stays unused
+            slot.generation = 1;
+        freeSlots.push_back(index);
+        active--;
+    }
+
+    size_t size() const
+    {
+        return active;
+    }
+
+    // open tickets; closing ones already have their unpark record in the journal
+    template <typename Fn>
+    void forEach(Fn fn)
+    {
+        for (uint32_t i = 0; i < slotCount; i++)
+        {
+            if (slotAt(i).inUse and !slotAt(i).closing)
+                fn(slotAt(i).ticket);
+        }
+    }
+
+    // Recovery: put a ticket back under its old id. Call rebuildFreeList() when done.
+    void restore(TicketId id, VehicleHandle vehicle, VehicleType type, SpotView spot, Ticks entryTime)
+    {
+        uint32_t index = ticketSlot(id);
+        growTo(index + 1);
+        Slot &slot = slotAt(index);
+        slot.generation = ticketGeneration(id);
+        slot.inUse = true;
+        slot.ticket = Ticket(id, vehicle, type, spot, entryTime);
+        active++;
+    }
+
+    // Recovery: generations of the slots, so ids handed out before the crash are never reissued
+    vector<uint32_t> getGenerations()
+    {
+        vector<uint32_t> generations(slotCount);
+        for (uint32_t i = 0; i < slotCount; i++)
+            generations[i] = slotAt(i).generation;
+        return generations;
+    }
+
+    void raiseGeneration(uint32_t index, uint32_t generation)
+    {
+        growTo(index + 1);
+        Slot &slot = slotAt(index);
+        if (!slot.inUse and generation > slot.generation)
+            slot.generation = generation;
+    }
+
+    void rebuildFreeList()
+    {
+        freeSlots.clear();
+        for (uint32_t i = slotCount; i-- > 0;)
+        {
+            if (!slotAt(i).inUse)
+                freeSlots.push_back(i);
+        }
+    }
+};
+
+// Secondary index vehicle id -> ticket, for "where is my car" and duplicate-entry checks.
+// Open addressing with linear probing over one flat array of 16-byte slots; the ids themselves are
+// interned into a single character arena (length-prefixed, no std::string / node per vehicle).
+// A 32-bit fingerprint of the hash in the slot skips the arena compare on almost every mismatch.
+// Erased slots become tombstones and their ids dead arena bytes; a rehash drops both, it runs when
+// tombstones fill the table or dead bytes make up half the arena.
+// Not thread-safe on its own, ParkingLot guards it together with the TicketTable.
+class VehicleIndex
+{
+public:
+    static constexpr size_t MAX_ID_LENGTH = UINT16_MAX; // longer ids are rejected
+
+private:
+    static constexpr uint32_t EMPTY = 0, ERASED = 1; // fingerprints of used slots are >= 2
+
+    struct Slot
+    {
+        uint32_t fingerprint;
+        uint32_t idOffset; // into arena: uint16 length, then the characters
+        TicketId ticketId;
+    };
+
+    vector<Slot> slots; // size is a power of two
+    string arena;
+    size_t deadBytes = 0; // arena bytes of erased ids
+    size_t used = 0;
+    size_t erased = 0;
+
+    static uint64_t hashOf(string_view id)
+    {
+        return hash<string_view>()(id);
+    }
+
+    static uint32_t fingerprintOf(uint64_t h)
+    {
+        uint32_t f = static_cast<uint32_t>(h >> 32);
+        return f < 2 ? f + 2 : f;
+    }
+
+    string_view idOf(const Slot &slot) const
+    {
+        uint16_t length;
+        memcpy(&length, arena.data() + slot.idOffset, sizeof(length));
+        return string_view(arena.data() + slot.idOffset + sizeof(length), length);
+    }
+
+    // slot holding id, or the first free slot of its probe chain (tombstone preferred)
+    size_t probe(string_view id, uint64_t h, bool &found) const
+    {
+        size_t mask = slots.size() - 1;
+        uint32_t fingerprint = fingerprintOf(h);
+        size_t firstErased = SIZE_MAX;
+        for (size_t i = h & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (slot.fingerprint == EMPTY)
+            {
+                found = false;
+                return firstErased != SIZE_MAX ? firstErased : i;
+            }
+            if (slot.fingerprint == ERASED)
+            {
+                if (firstErased == SIZE_MAX)
+                    firstErased = i;
+            }
+            else if (slot.fingerprint == fingerprint and idOf(slot) == id)
+            {
+                found = true;
+                return i;
+            }
+        }
+    }
+
+    void rehash(size_t capacity)
+    {
+        vector<Slot> old(capacity, Slot{EMPTY, 0, INVALID_TICKET});
+        old.swap(slots);
+        string oldArena;
+        oldArena.swap(arena);
+        arena.reserve(oldArena.size() - deadBytes);
+        used = erased = deadBytes = 0;
+        for (const Slot &slot : old)
+        {
+            if (slot.fingerprint < 2)
+                continue;
+            uint16_t length;
+            memcpy(&length, oldArena.data() + slot.idOffset, sizeof(length));
+            insert(string_view(oldArena.data() + slot.idOffset + sizeof(length), length), slot.ticketId);
+        }
+    }
+
+public:
+    VehicleIndex()
+    {
+        rehash(1024);
+    }
+
+    // false if the vehicle is already in the index (duplicate entry) or its id is longer than MAX_ID_LENGTH
+    bool insert(string_view id, TicketId ticketId)
+    {
+        if (id.size() > MAX_ID_LENGTH)
+            return false;
+        // load factor 0.7 with tombstones included, or an arena that is at least half dead
+        if ((used + erased + 1) * 10 > slots.size() * 7 or (deadBytes > 4096 and deadBytes * 2 > arena.size()))
+            rehash(used * 10 > slots.size() * 3 ? slots.size() * 2 : slots.size());
+        uint64_t h = hashOf(id);
+        bool found;
+        size_t i = probe(id, h, found);
+        if (found)
+            return false;
+        if (slots[i].fingerprint == ERASED)
+            erased--;
+        uint16_t length = static_cast<uint16_t>(id.size());
+        slots[i] = Slot{fingerprintOf(h), static_cast<uint32_t>(arena.size()), ticketId};
+        arena.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        arena.append(id.data(), length);
+        used++;
+        return true;
+    }
+
+    TicketId find(string_view id) const
+    {
+        bool found;
+        size_t i = probe(id, hashOf(id), found);
+        return found ? slots[i].ticketId : INVALID_TICKET;
+    }
+
+    bool erase(string_view id)
+    {
+        bool found;
+        size_t i = probe(id, hashOf(id), found);
+        if (!found)
+            return false;
+        deadBytes += sizeof(uint16_t) + idOf(slots[i]).size();
+        slots[i].fingerprint = ERASED;
+        used--;
+        erased++;
+        return true;
+    }
+
+    size_t size() const
+    {
+        return used;
+    }
+
+    size_t memoryBytes() const
+    {
+        return slots.capacity() * sizeof(Slot) + arena.capacity();
+    }
+};
+
+// Write-ahead journal: every park/unpark is appended as a small binary record, a background thread
+// writes + fsyncs whatever has piled up (group commit), so one fsync covers all gates that appended
+// in the meantime. Together with a snapshot of the active tickets it rebuilds the lot after a restart.
+enum class JournalOp : uint8_t
+{
+    PARK = 1,
+    UNPARK = 2
+};
+
+struct JournalEntry
+{
+    JournalOp op = JournalOp::PARK;
+    TicketId ticketId = INVALID_TICKET;
+    int32_t floorNumber = 0; // PARK only
+    uint32_t spotIndex = 0;  // PARK only
+    VehicleType vehicleType = VehicleType::CAR;
+    int64_t entryTime = 0;
+    string vehicleId;
+};
+
+class ParkingJournal
+{
+private:
+    // op(1) type(1) idLen(2) floor(4) spot(4) ticket(8) entry(8) + vehicleId bytes
+    static const size_t HEADER_SIZE = 28;
+
+    int fd = -1;
+    mutex mtx;
+    condition_variable workReady;
+    condition_variable flushed;
+    string pending;          // encoded records not yet written
+    uint64_t appendedLsn = 0; // record count appended / made durable so far
+    uint64_t durableLsn = 0;
+    bool flushing = false;
+    bool stopping = false;
+    bool failed = false; // sticky: after a failed write/sync nothing appended is durable any more
+    thread flusher;
+
+    template <typename T>
+    static void put(string &out, const T &value)
+    {
+        out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static T get(const char *p)
+    {
+        T value;
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
+
+    static bool writeAll(int fd, const string &data)
+    {
+        size_t done = 0;
+        while (done < data.size())
+        {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0 and errno == EINTR)
+                continue; // a signal, not a failed write: a failure would reject the parks in this batch
+            if (n < 0)
+                return false;
+            done += n;
+        }
+        return true;
+    }
+
+    void flushLoop()
+    {
+        unique_lock<mutex> lock(mtx);
+        while (true)
+        {
+            workReady.wait(lock, [this]()
+                           { return stopping or !pending.empty(); });
+            if (pending.empty())
+                break; // stopping and nothing left
+            string batch;
+            batch.swap(pending);
+            uint64_t upTo = appendedLsn;
+            flushing = true;
+            lock.unlock();
+
+            // after a failure the file may end in a torn record, writing on would hide it from replay
+            bool written = !failed and writeAll(fd, batch) and fdatasync(fd) == 0;
+
+            lock.lock();
+            flushing = false;
+            if (written)
+                durableLsn = max(durableLsn, upTo);
+            else if (!failed)
+            {
+                failed = true;
+                cerr << "Journal write failed\n";
+            }
+            flushed.notify_all();
+        }
+    }
+
+public:
+    static void encode(const JournalEntry &entry, string &out)
+    {
+        put(out, static_cast<uint8_t>(entry.op));
+        put(out, static_cast<uint8_t>(entry.vehicleType));
+        put(out, static_cast<uint16_t>(entry.vehicleId.size()));
+        put(out, entry.floorNumber);
+        put(out, entry.spotIndex);
+        put(out, entry.ticketId);
+        put(out, entry.entryTime);
+        out += entry.vehicleId;
+    }
+
+    // false at the end of the data or on a torn (half written) last record
+    static bool decode(const char *&p, const char *end, JournalEntry &entry)
+    {
+        if (static_cast<size_t>(end - p) < HEADER_SIZE)
+            return false;
+        uint16_t idLength = get<uint16_t>(p + 2);
+        if (static_cast<size_t>(end - p) < HEADER_SIZE + idLength)
+            return false;
+        entry.op = static_cast<JournalOp>(get<uint8_t>(p));
+        entry.vehicleType = static_cast<VehicleType>(get<uint8_t>(p + 1));
+        entry.floorNumber = get<int32_t>(p + 4);
+        entry.spotIndex = get<uint32_t>(p + 8);
+        entry.ticketId = get<TicketId>(p + 12);
+        entry.entryTime = get<int64_t>(p + 20);
+        entry.vehicleId.assign(p + HEADER_SIZE, idLength);
+        p += HEADER_SIZE + idLength;
+        return true;
+    }
+
+    static string readFile(const string &path)
+    {
+        ifstream in(path, ios::binary);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    // appends to an existing journal, so a recovered lot keeps logging to the same file
+    explicit ParkingJournal(const string &path)
+    {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd >= 0)
+            flusher = thread(&ParkingJournal::flushLoop, this);
+    }
+
+    ~ParkingJournal()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        workReady.notify_one();
+        if (flusher.joinable())
+            flusher.join();
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    ParkingJournal(const ParkingJournal &) = delete;
+    ParkingJournal &operator=(const ParkingJournal &) = delete;
+
+    bool isOpen() const
+    {
+        return fd >= 0;
+    }
+
+    // cheap, only buffers; returns the position to wait for
+    uint64_t append(const JournalEntry &entry)
+    {
+        lock_guard<mutex> lock(mtx);
+        encode(entry, pending);
+        uint64_t lsn = ++appendedLsn;
+        workReady.notify_one();
+        return lsn;
+    }
+
+    // false if the journal failed, the record may or may not be on disk
+    bool waitDurable(uint64_t lsn)
+    {
+        unique_lock<mutex> lock(mtx);
+        flushed.wait(lock, [&]()
+                     { return durableLsn >= lsn or failed; });
+        return !failed;
+    }
+
+    bool hasFailed()
+    {
+        lock_guard<mutex> lock(mtx);
+        return failed;
+    }
+
+    // Everything appended so far is covered by a snapshot that was just written -> start an empty log.
+    // Caller makes sure nothing is appended meanwhile. false (and the journal failed) if it can't be
+    // truncated; a failed journal is left as it is, its records replay consistently over the snapshot.
+    bool truncate()
+    {
+        unique_lock<mutex> lock(mtx);
+        flushed.wait(lock, [this]()
+                     { return !flushing; });
+        if (failed)
+            return false;
+        pending.clear();
+        if (ftruncate(fd, 0) != 0 or fdatasync(fd) != 0)
+        {
+            failed = true;
+            cerr << "Journal truncate failed\n";
+            flushed.notify_all();
+            return false;
+        }
+        durableLsn = appendedLsn;
+        flushed.notify_all();
+        return true;
+    }
+};
+
+// Pricing Strategies
+class PricingStrategy
+{
+public:
+    virtual double calculatePrice(Ticks entry, Ticks exit, VehicleType type) = 0;
+
+    // Batch form for settlement runs: prices[i] for (entries[i], exits[i], types[i]).
+    // Default is one virtual call per ticket, strategies override it with a tight loop.
+    virtual void calculatePrices(const Ticks *entries, const Ticks *exits, const VehicleType *types,
+                                 double *prices, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            prices[i] = calculatePrice(entries[i], exits[i], types[i]);
+    }
+
+    // strategies that price by live occupancy return themselves, the lot attaches them to its floors
+    virtual OccupancyObserver *getOccupancyObserver()
+    {
+        return nullptr;
+    }
+
+    virtual ~PricingStrategy() = default;
+};
+
+// isolated and extensible
+class HourlyPricingStrategy : public PricingStrategy
+{
+private:
+    // per started hour, index = static_cast<int>(VehicleType): bike, car, truck
+    static constexpr double RATES[3] = {10.0, 20.0, 40.0};
+
+public:
+    double calculatePrice(Ticks entry, Ticks exit, VehicleType type) override
+    {
+        double hours = static_cast<double>(exit - entry) / TICKS_PER_HOUR;
+        return ceil(hours) * RATES[static_cast<int>(type)];
+    }
+
+    // no virtual call, no branches: table lookup + arithmetic, the compiler can vectorize it
+    void calculatePrices(const Ticks *entries, const Ticks *exits, const VehicleType *types,
+                         double *prices, size_t count) override
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            double hours = static_cast<double>(exits[i] - entries[i]) * (1.0 / TICKS_PER_HOUR);
+            prices[i] = ceil(hours) * RATES[static_cast<int>(types[i])];
+        }
+    }
+};
+
+// Price per started hour by hour of the week, per vehicle type. Day 0 = Monday, hours local time.
+class TariffTable
+{
+public:
+    static const int HOURS_PER_WEEK = 7 * 24;
+
+private:
+    double rates[3][HOURS_PER_WEEK];
+
+public:
+    // flat rates all week, index = static_cast<int>(VehicleType)
+    TariffTable(double bike = 10.0, double car = 20.0, double truck = 40.0)
+    {
+        double base[3] = {bike, car, truck};
+        for (int t = 0; t < 3; t++)
+            fill(begin(rates[t]), end(rates[t]), base[t]);
+    }
+
+    // hours [fromHour, toHour) of every day
+    TariffTable &setDailyRate(VehicleType type, int fromHour, int toHour, double rate)
+    {
+        for (int day = 0; day < 7; day++)
+            setRate(type, day, fromHour, toHour, rate);
+        return *this;
+    }
+
+    TariffTable &setRate(VehicleType type, int day, int fromHour, int toHour, double rate)
+    {
+        for (int hour = max(fromHour, 0); hour < min(toHour, 24); hour++)
+            rates[static_cast<int>(type)][day * 24 + hour] = rate;
+        return *this;
+    }
+
+    double getRate(VehicleType type, int hourOfWeek) const
+    {
+        return rates[static_cast<int>(type)][hourOfWeek];
+    }
+};
+
+// from this occupancy (0..1) of the vehicle's spot type upwards, prices are multiplied by `multiplier`
+struct SurgeStep
+{
+    double occupancy;
+    double multiplier;
+};
+
+// Time-of-day tariffs x occupancy surge.
+// The tariffs are compiled once into running sums over two weeks, so the cost of any stay is
+// whole weeks + one difference of two entries: a quote is a few loads, no loop over the hours.
+// The floors report every spot taken/freed; each report updates the type's counters and stores the
+// surge multiplier for the new occupancy (a table lookup), quotes only load it.
+class DynamicPricingStrategy : public PricingStrategy, public OccupancyObserver
+{
+private:
+    static const int HOURS = TariffTable::HOURS_PER_WEEK;
+    static const int PERCENT_STEPS = 101;
+
+    double cumulative[3][2 * HOURS + 1]; // cost of the hours [0, h) from Monday 00:00, two weeks long
+    double weekCost[3];
+    double surgeByPercent[PERCENT_STEPS];
+    Ticks utcOffset; // local time = clock time + utcOffset
+
+    // per spot type: occupied (low 32 bits) | capacity (high 32 bits), one atomic so they match
+    atomic<uint64_t> occupancy[3] = {};
+    atomic<double> surge[3];
+
+    static uint32_t occupiedOf(uint64_t state)
+    {
+        return static_cast<uint32_t>(state);
+    }
+
+    static uint32_t capacityOf(uint64_t state)
+    {
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    double surgeFor(uint64_t state) const
+    {
+        uint32_t capacity = capacityOf(state);
+        if (capacity == 0)
+            return surgeByPercent[0];
+        uint64_t percent = min<uint64_t>(100, uint64_t(occupiedOf(state)) * 100 / capacity);
+        return surgeByPercent[percent];
+    }
+
+    // hour of the week of a clock time, 1970-01-01 was a Thursday
+    int hourOfWeek(Ticks time) const
+    {
+        Ticks hours = (time + utcOffset) / TICKS_PER_HOUR + 3 * 24;
+        return static_cast<int>(((hours % HOURS) + HOURS) % HOURS);
+    }
+
+    double tariffCost(int type, Ticks entry, Ticks exit) const
+    {
+        if (exit <= entry)
+            return 0.0;
+        Ticks hours = (exit - entry + TICKS_PER_HOUR - 1) / TICKS_PER_HOUR; // started hours
+        int first = hourOfWeek(entry);
+        int rest = static_cast<int>(hours % HOURS);
+        return static_cast<double>(hours / HOURS) * weekCost[type] + cumulative[type][first + rest] - cumulative[type][first];
+    }
+
+public:
+    // steps sorted by occupancy; below the first step the multiplier is 1
+    DynamicPricingStrategy(const TariffTable &tariffs,
+                           vector<SurgeStep> steps = {{0.70, 1.25}, {0.85, 1.5}, {0.95, 2.0}},
+                           Ticks localOffset = 0)
+        : utcOffset(localOffset)
+    {
+        for (int t = 0; t < 3; t++)
+        {
+            cumulative[t][0] = 0.0;
+            for (int h = 0; h < 2 * HOURS; h++)
+                cumulative[t][h + 1] = cumulative[t][h] + tariffs.getRate(static_cast<VehicleType>(t), h % HOURS);
+            weekCost[t] = cumulative[t][HOURS];
+        }
+        for (int percent = 0; percent < PERCENT_STEPS; percent++)
+        {
+            surgeByPercent[percent] = 1.0;
+            for (const SurgeStep &step : steps)
+            {
+                if (percent >= step.occupancy * 100.0 - 1e-9)
+                    surgeByPercent[percent] = step.multiplier;
+            }
+        }
+        for (auto &multiplier : surge)
+            multiplier.store(surgeByPercent[0], memory_order_relaxed);
+    }
+
+    // O(1) per event. Two gates can finish out of order: whoever stored last re-checks the counters
+    // and stores again until the multiplier matches them.
+    void occupancyChanged(SpotType type, int occupiedDelta, int capacityDelta) override
+    {
+        int t = static_cast<int>(type);
+        uint64_t delta = static_cast<uint64_t>((static_cast<int64_t>(capacityDelta) << 32) + occupiedDelta);
+        uint64_t state = occupancy[t].fetch_add(delta, memory_order_relaxed) + delta;
+        while (true)
+        {
+            surge[t].store(surgeFor(state), memory_order_relaxed);
+            uint64_t now = occupancy[t].load(memory_order_relaxed);
+            if (now == state)
+                return;
+            state = now;
+        }
+    }
+
+    OccupancyObserver *getOccupancyObserver() override
+    {
+        return this;
+    }
+
+    // for display boards
+    double getSurge(SpotType type) const
+    {
+        return surge[static_cast<int>(type)].load(memory_order_relaxed);
+    }
+
+    double getOccupancy(SpotType type) const
+    {
+        uint64_t state = occupancy[static_cast<int>(type)].load(memory_order_relaxed);
+        return capacityOf(state) ? static_cast<double>(occupiedOf(state)) / capacityOf(state) : 0.0;
+    }
+
+    // surge of the vehicle's own spot type at the time of the quote
+    double calculatePrice(Ticks entry, Ticks exit, VehicleType type) override
+    {
+        int t = static_cast<int>(type);
+        return tariffCost(t, entry, exit) * surge[t].load(memory_order_relaxed);
+    }
+
+    void calculatePrices(const Ticks *entries, const Ticks *exits, const VehicleType *types,
+                         double *prices, size_t count) override
+    {
+        double multipliers[3];
+        for (int t = 0; t < 3; t++)
+            multipliers[t] = surge[t].load(memory_order_relaxed);
+        for (size_t i = 0; i < count; i++)
+        {
+            int t = static_cast<int>(types[i]);
+            prices[i] = tariffCost(t, entries[i], exits[i]) * multipliers[t];
+        }
+    }
+};
+
+// Payment Strategy
+class PaymentMethod
+{
+public:
+    virtual bool pay(double amount) = 0;
+    virtual ~PaymentMethod() = default;
+};
+
+class UPIPayment : public PaymentMethod
+{
+public:
+    bool pay(double amount) override
+    {
+        cout << "Paid " << amount << " via UPI\n";
+        return true;
+    }
+};
+
+// Outcome of an asynchronous payment
+struct PaymentResult
+{
+    TicketId ticketId = INVALID_TICKET;
+    double amount = 0.0;
+    bool paid = false;
+    int attempts = 0;
+    string error; // what the last attempt threw, empty if pay() just returned false
+};
+
+// Payments run on a small worker pool, off the gate's thread and outside every lot lock.
+// A failed (false or throwing) pay() is retried with exponential backoff; the caller gets a future
+// and/or a callback, paid = false once every attempt failed.
+class PaymentPipeline
+{
+private:
+    struct Job
+    {
+        PaymentResult result;
+        shared_ptr<PaymentMethod> method; // kept alive until the job is done
+        function<void(const PaymentResult &)> onDone;
+        promise<PaymentResult> done;
+    };
+
+    int maxAttempts;
+    chrono::milliseconds retryBackoff;
+    deque<Job> jobs;
+    mutex mtx;
+    condition_variable jobReady;
+    bool stopping = false;
+    vector<thread> workers;
+
+    void workLoop()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                unique_lock<mutex> lock(mtx);
+                jobReady.wait(lock, [this]()
+                              { return stopping or !jobs.empty(); });
+                if (jobs.empty())
+                    return; // stopping and drained
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+
+            chrono::milliseconds backoff = retryBackoff;
+            while (!job.result.paid and job.result.attempts < maxAttempts)
+            {
+                if (job.result.attempts > 0)
+                {
+                    this_thread::sleep_for(backoff);
+                    backoff *= 2;
+                }
+                job.result.attempts++;
+                // a throwing gateway is a failed attempt like any other, it must not take the worker down
+                try
+                {
+                    job.result.paid = job.method->pay(job.result.amount);
+                    job.result.error.clear();
+                }
+                catch (const exception &e)
+                {
+                    job.result.error = e.what();
+                }
+                catch (...)
+                {
+                    job.result.error = "unknown exception";
+                }
+            }
+            if (job.onDone)
+                job.onDone(job.result);
+            job.done.set_value(job.result);
+        }
+    }
+
+public:
+    PaymentPipeline(size_t workerCount, int attempts = 3, chrono::milliseconds backoff = chrono::milliseconds(50))
+        : maxAttempts(max(1, attempts)), retryBackoff(backoff)
+    {
+        for (size_t i = 0; i < max<size_t>(1, workerCount); i++)
+            workers.emplace_back(&PaymentPipeline::workLoop, this);
+    }
+
+    // finishes every queued payment before returning
+    ~PaymentPipeline()
+    {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    future<PaymentResult> submit(TicketId ticketId, double amount, shared_ptr<PaymentMethod> method,
+                                 function<void(const PaymentResult &)> onDone = nullptr)
+    {
+        Job job;
+        job.result.ticketId = ticketId;
+        job.result.amount = amount;
+        job.method = move(method);
+        job.onDone = move(onDone);
+        future<PaymentResult> result = job.done.get_future();
+        {
+            lock_guard<mutex> lock(mtx);
+            jobs.push_back(move(job));
+        }
+        jobReady.notify_one();
+        return result;
+    }
+};
+
+// Range add / range max over time buckets, max(children) + own add per node (no push-down)
+class IntervalMaxTree
+{
+private:
+    int size;
+    vector<int32_t> maxValue;
+    vector<int32_t> pendingAdd;
+
+    void add(int node, int lo, int hi, int from, int to, int32_t delta)
+    {
+        if (to < lo or hi < from)
+            return;
+        if (from <= lo and hi <= to)
+        {
+            maxValue[node] += delta;
+            pendingAdd[node] += delta;
+            return;
+        }
+        int mid = (lo + hi) / 2;
+        add(2 * node, lo, mid, from, to, delta);
+        add(2 * node + 1, mid + 1, hi, from, to, delta);
+        maxValue[node] = max(maxValue[2 * node], maxValue[2 * node + 1]) + pendingAdd[node];
+    }
+
+    int32_t query(int node, int lo, int hi, int from, int to) const
+    {
+        if (to < lo or hi < from)
+            return INT32_MIN;
+        if (from <= lo and hi <= to)
+            return maxValue[node];
+        int mid = (lo + hi) / 2;
+        return max(query(2 * node, lo, mid, from, to), query(2 * node + 1, mid + 1, hi, from, to)) + pendingAdd[node];
+    }
+
+public:
+    explicit IntervalMaxTree(int n) : size(n), maxValue(4 * n, 0), pendingAdd(4 * n, 0) {}
+
+    // inclusive bucket range
+    void addRange(int from, int to, int32_t delta)
+    {
+        add(1, 0, size - 1, from, to, delta);
+    }
+
+    int32_t maxRange(int from, int to) const
+    {
+        return query(1, 0, size - 1, from, to);
+    }
+};
+
+// Pre-bookings. A reservation holds capacity of one SpotType for [from, to), not a fixed spot:
+// per type a calendar of reserved counts (time buckets in an IntervalMaxTree), so "is a spot of
+// type T free from t1 to t2" is one O(log buckets) range max, independent of spots and bookings.
+// When the vehicle arrives its booking is taken off the calendar; its real spot shows up in the
+// floor counters from then on.
+using ReservationId = uint64_t;
+const ReservationId INVALID_RESERVATION = 0;
+
+struct Reservation
+{
+    string vehicleId;
+    SpotType type = SpotType::CAR;
+    Ticks from = 0;
+    Ticks to = 0;
+};
+
+class ReservationBook
+{
+private:
+    Ticks origin;
+    Ticks bucketTicks;
+    int bucketCount;
+    vector<IntervalMaxTree> calendars; // per SpotType
+    unordered_map<ReservationId, Reservation> reservations;
+    ReservationId nextId = 1;
+    mutable mutex mtx;
+
+    // inclusive bucket range covering [from, to), false if outside the calendar
+    bool toBuckets(Ticks from, Ticks to, int &first, int &last) const
+    {
+        if (to <= from or from < origin)
+            return false;
+        Ticks lastBucket = (to - 1 - origin) / bucketTicks;
+        if (lastBucket >= bucketCount)
+            return false;
+        first = static_cast<int>((from - origin) / bucketTicks);
+        last = static_cast<int>(lastBucket);
+        return true;
+    }
+
+    int32_t reservedIn(SpotType type, Ticks from, Ticks to) const
+    {
+        Ticks begin = max(from, origin);
+        Ticks end = min(to, origin + bucketTicks * bucketCount);
+        int first, last;
+        if (!toBuckets(begin, end, first, last))
+            return 0;
+        return calendars[static_cast<int>(type)].maxRange(first, last);
+    }
+
+public:
+    // calendar from `start`, e.g. 15 minute buckets for 90 days
+    ReservationBook(Ticks start, Ticks bucket, int buckets)
+        : origin(start), bucketTicks(bucket), bucketCount(buckets), calendars(3, IntervalMaxTree(buckets)) {}
+
+    // capacity = spots of this type in the lot
+    ReservationId reserve(const string &vehicleId, SpotType type, Ticks from, Ticks to, uint32_t capacity)
+    {
+        lock_guard<mutex> lock(mtx);
+        int first, last;
+        if (!toBuckets(from, to, first, last))
+            return INVALID_RESERVATION;
+        IntervalMaxTree &calendar = calendars[static_cast<int>(type)];
+        if (calendar.maxRange(first, last) >= static_cast<int32_t>(capacity))
+            return INVALID_RESERVATION; // fully booked somewhere in the window
+        calendar.addRange(first, last, +1);
+        ReservationId id = nextId++;
+        reservations[id] = Reservation{vehicleId, type, from, to};
+        return id;
+    }
+
+    // number of spots of this type still bookable for the whole window
+    int32_t available(SpotType type, Ticks from, Ticks to, uint32_t capacity) const
+    {
+        lock_guard<mutex> lock(mtx);
+        return max<int32_t>(0, static_cast<int32_t>(capacity) - reservedIn(type, from, to));
+    }
+
+    // spots of this type that walk-ins must leave free: bookings active now or starting within `lookahead`
+    int32_t held(SpotType type, Ticks now, Ticks lookahead) const
+    {
+        lock_guard<mutex> lock(mtx);
+        return reservedIn(type, now, now + lookahead);
+    }
+
+    bool find(ReservationId id, Reservation &out) const
+    {
+        lock_guard<mutex> lock(mtx);
+        auto it = reservations.find(id);
+        if (it == reservations.end())
+            return false;
+        out = it->second;
+        return true;
+    }
+
+    // cancel, or the vehicle arrived at `now`: the rest of the window is released
+    bool release(ReservationId id, Ticks now)
+    {
+        lock_guard<mutex> lock(mtx);
+        auto it = reservations.find(id);
+        if (it == reservations.end())
+            return false;
+        const Reservation &booking = it->second;
+        int first, last;
+        if (now < booking.to and toBuckets(booking.from, booking.to, first, last))
+        {
+            if (now > booking.from)
+                first = max(first, static_cast<int>((now - origin) / bucketTicks));
+            calendars[static_cast<int>(booking.type)].addRange(first, last, -1);
+        }
+        reservations.erase(it);
+        return true;
+    }
+
+    // forget bookings whose window is over (no-shows), O(bookings), run periodically
+    size_t purgeExpired(Ticks now)
+    {
+        lock_guard<mutex> lock(mtx);
+        size_t purged = 0;
+        for (auto it = reservations.begin(); it != reservations.end();)
+        {
+            if (it->second.to <= now)
+            {
+                it = reservations.erase(it);
+                purged++;
+            }
+            else
+                ++it;
+        }
+        return purged;
+    }
+
+    size_t size() const
+    {
+        lock_guard<mutex> lock(mtx);
+        return reservations.size();
+    }
+};
+
+// Which spot a vehicle gets. Floors are tried starting at the gate's own floor.
+class SpotAllocationPolicy
+{
+public:
+    virtual SpotView allocate(const vector<ParkingFloor *> &floors, size_t gate,
+                              const Vehicle &vehicle) = 0;
+
+    // fills spots[i] for each vehicle, default one allocate() per vehicle
+    virtual void allocateBatch(const vector<ParkingFloor *> &floors, size_t gate,
+                               const vector<Vehicle> &vehicles, vector<SpotView> &spots)
+    {
+        for (size_t i = 0; i < vehicles.size(); i++)
+            spots[i] = allocate(floors, gate, vehicles[i]);
+    }
+
+    virtual bool needsDistanceIndex() const
+    {
+        return false;
+    }
+
+    virtual ~SpotAllocationPolicy() = default;
+};
+
+// Default: first floor (from the gate) with any fitting spot, smallest type on that floor.
+// Cheapest, but spills cars into truck spots while other floors still have car spots.
+class FirstFitPolicy : public SpotAllocationPolicy
+{
+public:
+    SpotView allocate(const vector<ParkingFloor *> &floors, size_t gate,
+                      const Vehicle &vehicle) override
+    {
+        size_t n = floors.size();
+        ScanLength scan;
+        // 1st pass: skip floors another gate is working on, 2nd pass: wait for them
+        bool contended = false;
+        for (size_t i = 0; i < n; i++)
+        {
+            scan.floors++;
+            if (SpotView spot = floors[(gate + i) % n]->tryParkVehicle(vehicle.getType(), contended))
+                return spot;
+        }
+        if (!contended)
+            return SpotView();
+        for (size_t i = 0; i < n; i++)
+        {
+            scan.floors++;
+            if (SpotView spot = floors[(gate + i) % n]->parkVehicle(vehicle.getType()))
+                return spot;
+        }
+        return SpotView();
+    }
+
+    // one lock per floor for the whole batch
+    void allocateBatch(const vector<ParkingFloor *> &floors, size_t gate,
+                       const vector<Vehicle> &vehicles, vector<SpotView> &spots) override
+    {
+        size_t n = floors.size();
+        size_t pending = vehicles.size();
+        for (size_t i = 0; i < n and pending > 0; i++)
+            pending -= floors[(gate + i) % n]->parkVehicles(vehicles, spots);
+    }
+};
+
+// Smallest fitting spot type in the whole lot: a car only gets a truck spot when no floor has a car
+// spot left. Uses the floors' lock-free free counters, so O(floors) per vehicle.
+class BestFitPolicy : public SpotAllocationPolicy
+{
+public:
+    SpotView allocate(const vector<ParkingFloor *> &floors, size_t gate,
+                      const Vehicle &vehicle) override
+    {
+        size_t n = floors.size();
+        ScanLength scan;
+        for (int t = static_cast<int>(vehicle.getType()); t < 3; t++)
+        {
+            SpotType type = static_cast<SpotType>(t);
+            for (size_t i = 0; i < n; i++)
+            {
+                scan.floors++;
+                ParkingFloor *floor = floors[(gate + i) % n];
+                if (floor->getFreeCount(type) == 0)
+                    continue;
+                if (SpotView spot = floor->parkVehicleInType(type))
+                    return spot;
+            }
+        }
+        return SpotView();
+    }
+};
+
+// Nearest fitting spot to the entrance (distance given to ParkingFloor::addSpot), any floor.
+// Floors keep free spots ordered by distance -> O(floors * log spots) per vehicle.
+class NearestToEntrancePolicy : public SpotAllocationPolicy
+{
+public:
+    SpotView allocate(const vector<ParkingFloor *> &floors, size_t,
+                      const Vehicle &vehicle) override
+    {
+        // another gate can take the chosen spot between the look and the claim, then look again
+        ScanLength scan;
+        for (int attempt = 0; attempt < 3; attempt++)
+        {
+            scan.floors += floors.size();
+            ParkingFloor *bestFloor = nullptr;
+            SpotType bestType = SpotType::TRUCK;
+            uint32_t bestDistance = UINT32_MAX;
+            for (ParkingFloor *floor : floors)
+            {
+                for (int t = static_cast<int>(vehicle.getType()); t < 3; t++)
+                {
+                    SpotType type = static_cast<SpotType>(t);
+                    if (floor->getFreeCount(type) == 0)
+                        continue;
+                    uint32_t distance = floor->nearestFreeDistance(type);
+                    if (distance < bestDistance)
+                    {
+                        bestDistance = distance;
+                        bestFloor = floor;
+                        bestType = type;
+                    }
+                }
+            }
+            if (!bestFloor)
+                return SpotView();
+            if (SpotView spot = bestFloor->parkVehicleNearest(bestType))
+                return spot;
+        }
+        return SpotView();
+    }
+
+    bool needsDistanceIndex() const override
+    {
+        return true;
+    }
+};
+
+// Floor with the most free fitting spots, spreads load (and gate traffic) evenly across floors.
+class FloorBalancingPolicy : public SpotAllocationPolicy
+{
+public:
+    SpotView allocate(const vector<ParkingFloor *> &floors, size_t gate,
+                      const Vehicle &vehicle) override
+    {
+        ScanLength scan;
+        scan.floors = floors.size();
+        ParkingFloor *emptiest = nullptr;
+        uint32_t mostFree = 0;
+        for (ParkingFloor *floor : floors)
+        {
+            uint32_t free = 0;
+            for (int t = static_cast<int>(vehicle.getType()); t < 3; t++)
+                free += floor->getFreeCount(static_cast<SpotType>(t));
+            if (free > mostFree)
+            {
+                mostFree = free;
+                emptiest = floor;
+            }
+        }
+        if (emptiest)
+        {
+            if (SpotView spot = emptiest->parkVehicle(vehicle.getType()))
+                return spot;
+        }
+        return FirstFitPolicy().allocate(floors, gate, vehicle); // counters were stale
+    }
+};
+
+// RCU-style publication of a value that is read on every operation and replaced rarely.
+// Readers never block and never write shared cache lines beyond their own reader slot: pin the
+// current epoch's counter, load the pointer, unpin when done. A writer swaps the pointer, flips the
+// epoch and waits until the old epoch's readers are gone before deleting the old value.
+template <typename T>
+class RcuCell
+{
+private:
+    static const size_t READER_SLOTS = 64;
+
+    struct alignas(64) ReaderCount
+    {
+        atomic<uint32_t> count{0};
+    };
+
+    atomic<T *> current;
+    atomic<uint64_t> epoch{0};
+    mutable ReaderCount readers[2][READER_SLOTS];
+    mutex writeMtx;
+
+    // threads spread over the slots round-robin, a slot is shared only beyond 64 threads
+    static size_t readerSlot()
+    {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t slot = nextSlot.fetch_add(1, memory_order_relaxed) % READER_SLOTS;
+        return slot;
+    }
+
+    void synchronize()
+    {
+        uint64_t old = epoch.fetch_add(1, memory_order_seq_cst) % 2;
+        for (ReaderCount &reader : readers[old])
+        {
+            while (reader.count.load(memory_order_acquire) != 0)
+                this_thread::yield();
+        }
+    }
+
+public:
+    class ReadGuard
+    {
+    private:
+        ReaderCount *pinned;
+        T *value;
+
+    public:
+        ReadGuard(ReaderCount *r, T *v) : pinned(r), value(v) {}
+        ReadGuard(ReadGuard &&other) : pinned(other.pinned), value(other.value)
+        {
+            other.pinned = nullptr;
+        }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ~ReadGuard()
+        {
+            if (pinned)
+                pinned->count.fetch_sub(1, memory_order_release);
+        }
+
+        const T &operator*() const
+        {
+            return *value;
+        }
+
+        const T *operator->() const
+        {
+            return value;
+        }
+    };
+
+    explicit RcuCell(unique_ptr<T> initial) : current(initial.release()) {}
+
+    ~RcuCell()
+    {
+        delete current.load();
+    }
+
+    // the value stays valid (and unchanged) while the guard lives; nesting is fine
+    ReadGuard read() const
+    {
+        size_t slot = readerSlot();
+        while (true)
+        {
+            uint64_t seen = epoch.load(memory_order_seq_cst);
+            ReaderCount &reader = readers[seen % 2][slot];
+            reader.count.fetch_add(1, memory_order_seq_cst);
+            if (epoch.load(memory_order_seq_cst) == seen)
+                return ReadGuard(&reader, current.load(memory_order_seq_cst));
+            reader.count.fetch_sub(1, memory_order_release); // a writer flipped meanwhile, pin the new epoch
+        }
+    }
+
+    // blocks the writer (never the readers) until nobody can still see the old value
+    void publish(unique_ptr<T> value)
+    {
+        lock_guard<mutex> lock(writeMtx);
+        T *old = current.exchange(value.release(), memory_order_seq_cst);
+        synchronize();
+        delete old;
+    }
+
+    // waits until every read that started before the call is finished
+    void waitForReaders()
+    {
+        lock_guard<mutex> lock(writeMtx);
+        synchronize();
+    }
+};
+
+// Answer to "where is my car"
+struct VehicleLocation
+{
+    TicketId ticketId = INVALID_TICKET;
+    int floorNumber = 0;
+    uint32_t spotIndex = 0;
+    string spotId;
+    Ticks entryTime = 0;
+};
+
+// ParkingLot coordinates, doesn’t own logic.
+// Concurrency: spots are claimed under their floor's lock (the occupancy bits are atomic only for
+// lock-free readers), the lot's own mutex only guards the ticket map, so gates parking on different
+// floors run in parallel.
+// Floors can be added, taken offline and removed while the gates run: gates read the published
+// list of open floors without locking, operators build a new list and publish it (RcuCell).
+class ParkingLot
+{
+private:
+    // every floor not removed, owned here because tickets point into offline floors too (configMtx)
+    vector<unique_ptr<ParkingFloor>> ownedFloors;
+    vector<bool> floorOpen; // parallel to ownedFloors
+    RcuCell<vector<ParkingFloor *>> openFloors{make_unique<vector<ParkingFloor *>>()};
+    mutex configMtx;
+    unique_ptr<PricingStrategy> pricingStrategy;
+    shared_ptr<Clock> clock; // shared: the simulator keeps driving it
+
+    // ParkingLot OWNS all active tickets
+    TicketTable activeTickets;
+    VehiclePool vehicles;        // what the tickets' VehicleHandles point at
+    VehicleIndex parkedVehicles; // vehicle id -> ticket, same lock as the tickets
+    mutex ticketsMtx;
+
+    // optional; records are appended under ticketsMtx so the log order matches the ticket table
+    unique_ptr<ParkingJournal> journal;
+    size_t droppedOnRecovery = 0;
+
+    JournalEntry parkEntry(const Ticket &ticket) const
+    {
+        JournalEntry entry;
+        entry.op = JournalOp::PARK;
+        entry.ticketId = ticket.getTicketId();
+        entry.floorNumber = ticket.getParkingSpot().getFloor()->getFloorNumber();
+        entry.spotIndex = ticket.getParkingSpot().getIndex();
+        entry.vehicleType = ticket.getVehicleType();
+        entry.entryTime = ticket.getEntryTime();
+        entry.vehicleId = vehicles.get(ticket.getVehicle()).getVehicleId();
+        return entry;
+    }
+
+    static JournalEntry unparkEntry(TicketId ticketId)
+    {
+        JournalEntry entry;
+        entry.op = JournalOp::UNPARK;
+        entry.ticketId = ticketId;
+        return entry;
+    }
+
+    unique_ptr<SpotAllocationPolicy> allocationPolicy = make_unique<FirstFitPolicy>();
+
+    // optional pre-booking; walk-ins leave free what is booked from now to now + holdLookahead
+    unique_ptr<ReservationBook> reservations;
+    Ticks holdLookahead = 0;
+
+    uint32_t getTotalSpots(SpotType type) const
+    {
+        auto floors = openFloors.read();
+        uint32_t total = 0;
+        for (ParkingFloor *floor : *floors)
+            total += floor->getAvailability().totalSpots[static_cast<int>(type)];
+        return total;
+    }
+
+    // under configMtx
+    int findFloorLocked(int floorNumber) const
+    {
+        for (size_t i = 0; i < ownedFloors.size(); i++)
+        {
+            if (ownedFloors[i]->getFloorNumber() == floorNumber)
+                return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void publishFloorsLocked()
+    {
+        auto open = make_unique<vector<ParkingFloor *>>();
+        for (size_t i = 0; i < ownedFloors.size(); i++)
+        {
+            if (floorOpen[i])
+                open->push_back(ownedFloors[i].get());
+        }
+        openFloors.publish(move(open));
+    }
+
+    // write next to it + rename, a crash mid-write leaves the old file intact
+    static bool writeFileAtomically(const string &path, const string &data)
+    {
+        string tmpPath = path + ".tmp";
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        bool ok = ::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) and fsync(fd) == 0;
+        ::close(fd);
+        return ok and rename(tmpPath.c_str(), path.c_str()) == 0;
+    }
+
+    bool isHeld(SpotType type, Ticks now) const
+    {
+        return reservations and getFreeSpots(type) < static_cast<uint32_t>(reservations->held(type, now, holdLookahead));
+    }
+
+    // walk-in took a spot booked by someone else: give it back and look for an unbooked type
+    SpotView respectHolds(const vector<ParkingFloor *> &floors, SpotView spot, const Vehicle &vehicle)
+    {
+        if (!reservations or !spot)
+            return spot;
+        Ticks now = clock->now();
+        if (!isHeld(spot.getType(), now))
+            return spot;
+        spot.getFloor()->removeVehicle(spot.getIndex());
+        for (int t = static_cast<int>(vehicle.getType()); t < 3; t++)
+        {
+            SpotType type = static_cast<SpotType>(t);
+            if (getFreeSpots(type) <= static_cast<uint32_t>(reservations->held(type, now, holdLookahead)))
+                continue;
+            for (ParkingFloor *floor : floors)
+            {
+                if (SpotView other = floor->parkVehicleInType(type))
+                    return other;
+            }
+        }
+        return SpotView();
+    }
+
+    // under ticketsMtx: ticket + vehicle index entry, INVALID_TICKET if the vehicle is already inside
+    // or its id is too long to index
+    TicketId openTicketLocked(const Vehicle &vehicle, SpotView spot, Ticks now)
+    {
+        if (vehicle.getVehicleId().size() > VehicleIndex::MAX_ID_LENGTH or parkedVehicles.find(vehicle.getVehicleId()) != INVALID_TICKET)
+            return INVALID_TICKET;
+        TicketId ticketId = activeTickets.open(vehicles.acquire(vehicle), vehicle.getType(), spot, now);
+        parkedVehicles.insert(vehicle.getVehicleId(), ticketId);
+        return ticketId;
+    }
+
+    // under ticketsMtx: the ticket's slot is released by the caller
+    void dropVehicleLocked(const Ticket &ticket)
+    {
+        parkedVehicles.erase(vehicles.get(ticket.getVehicle()).getVehicleId());
+        vehicles.release(ticket.getVehicle());
+    }
+
+    // under ticketsMtx: undo openTicketLocked for a park whose journal record never became durable
+    // (the caller gives the spot back)
+    void discardTicketLocked(TicketId ticketId)
+    {
+        if (Ticket *ticket = activeTickets.find(ticketId))
+        {
+            dropVehicleLocked(*ticket);
+            activeTickets.release(ticketId);
+        }
+    }
+
+    TicketId openTicket(const Vehicle &vehicle, SpotView spot)
+    {
+        TicketId ticketId;
+        uint64_t lsn = 0;
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            ticketId = openTicketLocked(vehicle, spot, clock->now());
+            if (ticketId != INVALID_TICKET and journal)
+                lsn = journal->append(parkEntry(*activeTickets.find(ticketId)));
+        }
+        if (lsn and !journal->waitDurable(lsn)) // outside the lock, other gates join the same fsync
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            discardTicketLocked(ticketId);
+            ticketId = INVALID_TICKET; // not durable, the park never happened
+        }
+        if (ticketId == INVALID_TICKET)
+            spot.getFloor()->removeVehicle(spot.getIndex()); // duplicate entry or journal failure, give the spot back
+        return ticketId;
+    }
+
+    // closes the ticket, frees the spot and prices the stay; false for an invalid ticket or when the
+    // unpark can't be journaled (the ticket then stays open)
+    bool closeTicket(TicketId ticketId, double &amount)
+    {
+        OpTimer timer(Histogram::UNPARK_NS); // the lot's part, payment not included
+        Ticket ticket;
+        uint64_t lsn = 0;
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+
+            if (journal)
+            {
+                // keep the ticket (closing) until the record is durable, so a failure can reopen it
+                if (!activeTickets.beginClose(ticketId))
+                    return false; // invalid ticket
+                lsn = journal->append(unparkEntry(ticketId));
+            }
+            else
+            {
+                Ticket *active = activeTickets.find(ticketId);
+                if (!active)
+                {
+                    return false; // invalid ticket
+                }
+
+                // Extract ownership, the slot goes back to the table
+                ticket = move(*active);
+                activeTickets.release(ticketId);
+                dropVehicleLocked(ticket);
+            }
+        }
+        if (lsn)
+        {
+            bool durable = journal->waitDurable(lsn);
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            if (!durable)
+            {
+                activeTickets.cancelClose(ticketId);
+                return false;
+            }
+            ticket = move(*activeTickets.findClosing(ticketId));
+            activeTickets.release(ticketId);
+            dropVehicleLocked(ticket);
+        }
+
+        // Close ticket
+        ticket.closeTicket(clock->now());
+
+        // 🔥 CRUCIAL: free the spot
+        SpotView spot = ticket.getParkingSpot();
+        spot.getFloor()->removeVehicle(spot.getIndex());
+
+        // Calculate price
+        amount = pricingStrategy->calculatePrice(
+            ticket.getEntryTime(),
+            ticket.getExitTime(),
+            ticket.getVehicleType());
+        return true;
+    }
+
+    bool locateLocked(const string &vehicleId, VehicleLocation &location)
+    {
+        Ticket *ticket = activeTickets.find(parkedVehicles.find(vehicleId));
+        if (!ticket)
+            return false;
+        SpotView spot = ticket->getParkingSpot();
+        location.ticketId = ticket->getTicketId();
+        location.floorNumber = spot.getFloor()->getFloorNumber();
+        location.spotIndex = spot.getIndex();
+        location.spotId = spot.getSpotId();
+        location.entryTime = ticket->getEntryTime();
+        return true;
+    }
+
+    // payments are only queued here, PaymentPipeline does the slow part
+    unique_ptr<PaymentPipeline> payments;
+
+public:
+    ParkingLot(unique_ptr<PricingStrategy> strategy, shared_ptr<Clock> clk = make_shared<SystemClock>())
+        : pricingStrategy(move(strategy)), clock(move(clk)) {}
+
+    // open right away, also while the gates run
+    void addFloor(unique_ptr<ParkingFloor> floor)
+    {
+        lock_guard<mutex> lock(configMtx);
+        if (allocationPolicy->needsDistanceIndex())
+            floor->enableDistanceIndex();
+        if (OccupancyObserver *observer = pricingStrategy->getOccupancyObserver())
+            floor->setOccupancyObserver(observer);
+        ownedFloors.push_back(move(floor));
+        floorOpen.push_back(true);
+        publishFloorsLocked();
+    }
+
+    // Save the floors and spots (ids, types, distances, enabled or not) as a spot map for loadSpotMap.
+    // Meant for the empty lot a builder just put together: false if a floor has vehicles in it.
+    bool writeSpotMap(const string &path)
+    {
+        string data = "PLMAP001";
+        lock_guard<mutex> lock(configMtx);
+        uint32_t header[2] = {static_cast<uint32_t>(ownedFloors.size()), 0};
+        data.append(reinterpret_cast<const char *>(header), sizeof(header));
+        for (auto &floor : ownedFloors)
+        {
+            if (!floor->appendLayout(data))
+                return false;
+        }
+        return writeFileAtomically(path, data);
+    }
+
+    // Add every floor of a spot map without building it spot by spot: the floors work in place on the
+    // mapped file, so startup costs O(floors) and later only the pages the gates touch.
+    // All or nothing: false (no floor added) if the file can't be mapped or isn't a spot map.
+    bool loadSpotMap(const string &path)
+    {
+        auto file = make_shared<SpotMapFile>(path);
+        if (!file->isOpen() or file->size() < 16 or memcmp(file->data(), "PLMAP001", 8) != 0)
+            return false;
+        uint32_t floorCount;
+        memcpy(&floorCount, file->data() + 8, sizeof(floorCount));
+        vector<size_t> offsets;
+        size_t offset = 16;
+        for (uint32_t f = 0; f < floorCount; f++)
+        {
+            SpotMapFloor header;
+            if (file->size() - offset < sizeof(header))
+                return false;
+            memcpy(&header, file->data() + offset, sizeof(header));
+            if (!header.fits(file->size() - offset))
+                return false;
+            offsets.push_back(offset);
+            offset += header.blockBytes;
+        }
+        for (size_t floorOffset : offsets)
+            addFloor(make_unique<ParkingFloor>(file, floorOffset));
+        return true;
+    }
+
+    // Offline for maintenance: no new vehicles, the ones inside keep their tickets and can leave.
+    // false for an unknown floor number.
+    bool setFloorOpen(int floorNumber, bool open)
+    {
+        lock_guard<mutex> lock(configMtx);
+        int i = findFloorLocked(floorNumber);
+        if (i < 0)
+            return false;
+        if (floorOpen[i] != open)
+        {
+            floorOpen[i] = open;
+            // occupancy-priced lots stop counting an offline floor's spots
+            if (OccupancyObserver *observer = pricingStrategy->getOccupancyObserver())
+                ownedFloors[i]->setOccupancyObserver(open ? observer : nullptr);
+            publishFloorsLocked();
+        }
+        return true;
+    }
+
+    // Takes the floor offline and deletes it once no gate can still be using it.
+    // Refused (the floor stays offline) while vehicles are parked on it.
+    bool removeFloor(int floorNumber)
+    {
+        lock_guard<mutex> lock(configMtx);
+        int i = findFloorLocked(floorNumber);
+        if (i < 0)
+            return false;
+        if (floorOpen[i])
+        {
+            floorOpen[i] = false;
+            if (pricingStrategy->getOccupancyObserver())
+                ownedFloors[i]->setOccupancyObserver(nullptr);
+            publishFloorsLocked();
+        }
+        openFloors.waitForReaders(); // parks that picked the floor before it closed have their tickets now
+        if (ownedFloors[i]->countOccupied() > 0)
+            return false;
+        ownedFloors.erase(ownedFloors.begin() + i);
+        floorOpen.erase(floorOpen.begin() + i);
+        return true;
+    }
+
+    // Online maintenance of one spot, see ParkingFloor::setSpotEnabled
+    bool setSpotEnabled(int floorNumber, uint32_t spotIndex, bool enabled)
+    {
+        lock_guard<mutex> lock(configMtx);
+        int i = findFloorLocked(floorNumber);
+        return i >= 0 and ownedFloors[i]->setSpotEnabled(spotIndex, enabled);
+    }
+
+    // new spots on a floor that is already in the lot, also while the gates run
+    bool addSpot(int floorNumber, const string &spotId, SpotType type, uint32_t distance = 0)
+    {
+        lock_guard<mutex> lock(configMtx);
+        int i = findFloorLocked(floorNumber);
+        if (i < 0)
+            return false;
+        ownedFloors[i]->addSpot(spotId, type, distance);
+        return true;
+    }
+
+    // set before the gates open
+    void setAllocationPolicy(unique_ptr<SpotAllocationPolicy> policy)
+    {
+        lock_guard<mutex> lock(configMtx);
+        if (policy->needsDistanceIndex())
+        {
+            for (auto &floor : ownedFloors)
+                floor->enableDistanceIndex();
+        }
+        allocationPolicy = move(policy);
+    }
+
+    // Log every park/unpark to this file from now on. false if it can't be opened.
+    bool enableJournal(const string &path)
+    {
+        auto opened = make_unique<ParkingJournal>(path);
+        if (!opened->isOpen())
+            return false;
+        lock_guard<mutex> lock(ticketsMtx);
+        journal = move(opened);
+        return true;
+    }
+
+    // Compact snapshot of all active tickets (+ ticket slot generations); the journal restarts empty.
+    // Gates wait on the ticket lock while it is written.
+    bool writeSnapshot(const string &path)
+    {
+        lock_guard<mutex> lock(ticketsMtx);
+        string data = "PLSNAP02";
+        vector<uint32_t> generations = activeTickets.getGenerations();
+        uint32_t slots = static_cast<uint32_t>(generations.size());
+        data.append(reinterpret_cast<const char *>(&slots), sizeof(slots));
+        data.append(reinterpret_cast<const char *>(generations.data()), generations.size() * sizeof(uint32_t));
+        size_t countAt = data.size();
+        uint64_t count = 0;
+        data.append(reinterpret_cast<const char *>(&count), sizeof(count));
+        activeTickets.forEach([&](const Ticket &ticket)
+                              {
+                                  ParkingJournal::encode(parkEntry(ticket), data);
+                                  count++; });
+        memcpy(&data[countAt], &count, sizeof(count)); // unparks still waiting on the journal left out
+        if (!writeFileAtomically(path, data))
+            return false;
+        return !journal or journal->truncate();
+    }
+
+    // Rebuild the active tickets from snapshot + journal tail (either file may be missing).
+    // Call on a freshly built lot with the same floors/spots, before the gates open.
+    // Returns the number of tickets restored; tickets whose floor or spot no longer exists, or whose
+    // spot is already taken, are dropped (getDroppedOnRecovery).
+    size_t recover(const string &snapshotPath, const string &journalPath)
+    {
+        droppedOnRecovery = 0;
+        unordered_map<TicketId, JournalEntry> live;
+        vector<uint32_t> generations;
+
+        string snapshot = ParkingJournal::readFile(snapshotPath);
+        const char *p = snapshot.data();
+        const char *end = p + snapshot.size();
+        if (snapshot.size() >= 12 and snapshot.compare(0, 8, "PLSNAP02") == 0)
+        {
+            // every size in the file is checked against what is left; a short or corrupt snapshot is
+            // ignored as a whole and the journal alone is replayed
+            p += 8;
+            uint32_t slots;
+            memcpy(&slots, p, sizeof(slots));
+            p += sizeof(slots);
+            bool valid = static_cast<uint64_t>(slots) * sizeof(uint32_t) + sizeof(uint64_t) <= static_cast<uint64_t>(end - p);
+            uint64_t count = 0, decoded = 0;
+            if (valid)
+            {
+                generations.resize(slots);
+                memcpy(generations.data(), p, slots * sizeof(uint32_t));
+                p += slots * sizeof(uint32_t);
+                memcpy(&count, p, sizeof(count));
+                p += sizeof(count);
+                JournalEntry entry;
+                while (valid and ParkingJournal::decode(p, end, entry))
+                {
+                    valid = entry.op == JournalOp::PARK and entry.vehicleType <= VehicleType::TRUCK;
+                    live[entry.ticketId] = entry;
+                    decoded++;
+                }
+            }
+            if (!valid or p != end or decoded != count)
+            {
+                cerr << "Snapshot " << snapshotPath << " is corrupt, replaying the journal only\n";
+                generations.clear();
+                live.clear();
+            }
+        }
+
+        string log = ParkingJournal::readFile(journalPath);
+        p = log.data();
+        end = p + log.size();
+        JournalEntry entry;
+        while (ParkingJournal::decode(p, end, entry))
+        {
+            // closed tickets leave only their generation behind
+            uint32_t index = ticketSlot(entry.ticketId);
+            if (generations.size() <= index)
+                generations.resize(index + 1, 1);
+            uint32_t next = (ticketGeneration(entry.ticketId) + 1) & GENERATION_MASK;
+            generations[index] = max(generations[index], max(next, 1u));
+            if (entry.op == JournalOp::PARK)
+                live[entry.ticketId] = entry;
+            else
+                live.erase(entry.ticketId);
+        }
+
+        unordered_map<int, ParkingFloor *> floorByNumber;
+        lock_guard<mutex> configLock(configMtx);
+        for (auto &floor : ownedFloors)
+            floorByNumber[floor->getFloorNumber()] = floor.get();
+        unordered_map<ParkingFloor *, vector<uint32_t>> parkedPerFloor;
+        unordered_map<ParkingFloor *, vector<bool>> takenPerFloor; // spots given to a restored ticket
+
+        lock_guard<mutex> lock(ticketsMtx);
+        for (uint32_t i = 0; i < generations.size(); i++)
+            activeTickets.raiseGeneration(i, generations[i]);
+        size_t restored = 0;
+        for (auto &item : live)
+        {
+            const JournalEntry &parked = item.second;
+            auto floor = floorByNumber.find(parked.floorNumber);
+            if (floor == floorByNumber.end())
+            {
+                droppedOnRecovery++; // floor no longer exists
+                continue;
+            }
+            vector<bool> &taken = takenPerFloor[floor->second];
+            if (taken.empty())
+                taken.resize(floor->second->getSpotCount());
+            if (parked.spotIndex >= taken.size() or taken[parked.spotIndex] or floor->second->isOccupied(parked.spotIndex))
+            {
+                droppedOnRecovery++; // spot gone from the layout, or another ticket already holds it
+                continue;
+            }
+            taken[parked.spotIndex] = true;
+            VehicleHandle vehicle = vehicles.acquire(Vehicle(parked.vehicleId, parked.vehicleType));
+            parkedPerFloor[floor->second].push_back(parked.spotIndex);
+            activeTickets.restore(parked.ticketId, vehicle, parked.vehicleType, SpotView(floor->second, parked.spotIndex), parked.entryTime);
+            parkedVehicles.insert(parked.vehicleId, parked.ticketId);
+            restored++;
+        }
+        activeTickets.rebuildFreeList();
+        for (auto &item : parkedPerFloor)
+            item.first->restoreVehicles(item.second);
+        if (droppedOnRecovery)
+            cerr << "Recovery dropped " << droppedOnRecovery << " tickets whose floor or spot is missing or taken\n";
+        return restored;
+    }
+
+    // tickets the last recover() could not put back on a spot
+    size_t getDroppedOnRecovery() const
+    {
+        return droppedOnRecovery;
+    }
+
+    // "Where is my car": O(1) through the vehicle index
+    bool findVehicle(const string &vehicleId, VehicleLocation &location)
+    {
+        lock_guard<mutex> lock(ticketsMtx);
+        return locateLocked(vehicleId, location);
+    }
+
+    // bulk form, one lock for all ids; ticketId stays INVALID_TICKET for vehicles not inside
+    vector<VehicleLocation> findVehicles(const vector<string> &vehicleIds)
+    {
+        vector<VehicleLocation> locations(vehicleIds.size());
+        lock_guard<mutex> lock(ticketsMtx);
+        for (size_t i = 0; i < vehicleIds.size(); i++)
+            locateLocked(vehicleIds[i], locations[i]);
+        return locations;
+    }
+
+    // Free/total spots per type per floor for display boards. Reads only the floors' counters,
+    // never takes a lock, so polling it doesn't slow the gates down.
+    vector<FloorAvailability> getAvailability() const
+    {
+        auto floors = openFloors.read();
+        vector<FloorAvailability> snapshot;
+        snapshot.reserve(floors->size());
+        for (ParkingFloor *floor : *floors)
+            snapshot.push_back(floor->getAvailability());
+        return snapshot;
+    }
+
+    // open floors only
+    uint32_t getFreeSpots(SpotType type) const
+    {
+        auto floors = openFloors.read();
+        uint32_t total = 0;
+        for (ParkingFloor *floor : *floors)
+            total += floor->getAvailability().freeSpots[static_cast<int>(type)];
+        return total;
+    }
+
+    // ✅ Returns ticketId, not Ticket*
+    // gate: index of the entry gate, each gate starts searching on a different floor
+    // the vehicle is copied into the lot's pool, the caller keeps (or drops) its own object
+    TicketId parkVehicle(const Vehicle &vehicle, size_t gate = 0)
+    {
+        OpTimer timer(Histogram::PARK_NS);
+        auto floors = openFloors.read(); // held until the ticket exists, see removeFloor
+        SpotView spot = respectHolds(*floors, allocationPolicy->allocate(*floors, gate, vehicle), vehicle);
+        if (!spot)
+            return INVALID_TICKET; // parking lot full
+
+        return openTicket(vehicle, spot);
+    }
+
+    // Turn on pre-booking: calendar of `buckets` slots of `bucket` ticks from `start`.
+    // Walk-ins are turned away from spot types booked between now and now + lookahead.
+    void enableReservations(Ticks start, Ticks bucket, int buckets, Ticks lookahead)
+    {
+        reservations = make_unique<ReservationBook>(start, bucket, buckets);
+        holdLookahead = lookahead;
+    }
+
+    ReservationId reserveSpot(const string &vehicleId, SpotType type, Ticks from, Ticks to)
+    {
+        if (!reservations)
+            return INVALID_RESERVATION;
+        return reservations->reserve(vehicleId, type, from, to, getTotalSpots(type));
+    }
+
+    // how many spots of this type can still be booked for the whole window
+    int32_t getBookableSpots(SpotType type, Ticks from, Ticks to) const
+    {
+        return reservations ? reservations->available(type, from, to, getTotalSpots(type)) : 0;
+    }
+
+    bool cancelReservation(ReservationId id)
+    {
+        return reservations and reservations->release(id, clock->now());
+    }
+
+    // vehicle with a booking: gets a spot of the booked type even if walk-ins are held off,
+    // the booking is consumed
+    TicketId parkReservedVehicle(ReservationId id, const Vehicle &vehicle, size_t gate = 0)
+    {
+        Reservation booking;
+        if (!reservations or !reservations->find(id, booking) or booking.vehicleId != vehicle.getVehicleId())
+            return INVALID_TICKET;
+        if (static_cast<int>(booking.type) < static_cast<int>(vehicle.getType()))
+            return INVALID_TICKET; // booked a spot it doesn't fit in
+
+        auto floors = openFloors.read();
+        SpotView spot;
+        size_t n = floors->size();
+        for (size_t i = 0; i < n and !spot; i++)
+            spot = (*floors)[(gate + i) % n]->parkVehicleInType(booking.type);
+        if (!spot)
+            spot = allocationPolicy->allocate(*floors, gate, vehicle); // a walk-in overstayed, any fitting spot
+        if (!spot)
+            return INVALID_TICKET;
+        TicketId ticketId = openTicket(vehicle, spot);
+        if (ticketId != INVALID_TICKET)
+            reservations->release(id, clock->now()); // a duplicate entry keeps its booking
+        return ticketId;
+    }
+
+    double unparkVehicle(TicketId ticketId,
+                         PaymentMethod &payment)
+    {
+        double amount = 0.0;
+        if (!closeTicket(ticketId, amount))
+            return 0.0; // invalid ticket
+
+        payment.pay(amount); // on the caller's thread, but no lot lock is held any more
+        return amount;
+    }
+
+    // Start the payment worker pool used by unparkVehicleAsync
+    void enableAsyncPayments(size_t workers, int maxAttempts = 3,
+                             chrono::milliseconds retryBackoff = chrono::milliseconds(50))
+    {
+        payments = make_unique<PaymentPipeline>(workers, maxAttempts, retryBackoff);
+    }
+
+    // Spot is free when this returns; the payment (with retries) runs on the pipeline.
+    // Invalid ticket -> ready future with paid = false, amount = 0.
+    // Without enableAsyncPayments it falls back to a synchronous unpark: one pay() on the caller's
+    // thread, the future is ready on return.
+    future<PaymentResult> unparkVehicleAsync(TicketId ticketId, shared_ptr<PaymentMethod> payment,
+                                             function<void(const PaymentResult &)> onDone = nullptr)
+    {
+        double amount = 0.0;
+        bool closed = closeTicket(ticketId, amount);
+        if (!closed or !payments)
+        {
+            promise<PaymentResult> done;
+            PaymentResult result;
+            result.ticketId = ticketId;
+            if (closed)
+            {
+                result.amount = amount;
+                result.paid = payment->pay(amount);
+                result.attempts = 1;
+            }
+            if (onDone)
+                onDone(result);
+            done.set_value(result);
+            return done.get_future();
+        }
+        return payments->submit(ticketId, amount, move(payment), move(onDone));
+    }
+
+    // Batch variants for gate controllers that buffer events: every lock is taken once per batch
+    // (each floor once, the ticket table once) instead of once per vehicle.
+    // Results are per item, INVALID_TICKET / 0.0 where the single call would have failed.
+    vector<TicketId> parkVehicles(const vector<Vehicle> &arrivals, size_t gate = 0)
+    {
+        size_t count = arrivals.size();
+        vector<TicketId> tickets(count, INVALID_TICKET);
+        vector<SpotView> spots(count);
+
+        auto floors = openFloors.read();
+        if (reservations)
+        {
+            // holds depend on the free count after each claim: one vehicle at a time, like parkVehicle
+            for (size_t i = 0; i < count; i++)
+                spots[i] = respectHolds(*floors, allocationPolicy->allocate(*floors, gate, arrivals[i]), arrivals[i]);
+        }
+        else
+            allocationPolicy->allocateBatch(*floors, gate, arrivals, spots);
+
+        uint64_t lsn = 0;
+        Ticks now = clock->now(); // one clock read per batch
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!spots[i])
+                    continue;
+                tickets[i] = openTicketLocked(arrivals[i], spots[i], now);
+                if (tickets[i] != INVALID_TICKET and journal)
+                    lsn = journal->append(parkEntry(*activeTickets.find(tickets[i])));
+            }
+        }
+        if (lsn and !journal->waitDurable(lsn)) // one wait for the whole batch
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            for (TicketId &ticketId : tickets)
+            {
+                discardTicketLocked(ticketId);
+                ticketId = INVALID_TICKET;
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (spots[i] and tickets[i] == INVALID_TICKET)
+                spots[i].getFloor()->removeVehicle(spots[i].getIndex()); // duplicate entry or journal failure
+        }
+        return tickets;
+    }
+
+    vector<double> unparkVehicles(const vector<TicketId> &ticketIds, PaymentMethod &payment)
+    {
+        size_t count = ticketIds.size();
+        vector<Ticket> tickets(count);
+        vector<double> amounts(count, 0.0);
+        vector<char> closing(count, 0); // journaled: closes begun by this batch
+        uint64_t lsn = 0;
+        {
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (journal)
+                {
+                    closing[i] = activeTickets.beginClose(ticketIds[i]) != nullptr; // invalid ticket: amount stays 0
+                    if (closing[i])
+                        lsn = journal->append(unparkEntry(ticketIds[i]));
+                    continue;
+                }
+                Ticket *active = activeTickets.find(ticketIds[i]);
+                if (!active)
+                    continue; // invalid ticket, amount stays 0
+                tickets[i] = move(*active);
+                activeTickets.release(ticketIds[i]);
+                dropVehicleLocked(tickets[i]);
+            }
+        }
+        if (lsn)
+        {
+            // durable: finish the closes; journal failed: the whole batch stays parked, amounts 0
+            bool durable = journal->waitDurable(lsn);
+            MeteredLock lock(ticketsMtx, LockSite::TICKETS);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!closing[i])
+                    continue;
+                if (!durable)
+                {
+                    activeTickets.cancelClose(ticketIds[i]);
+                    continue;
+                }
+                tickets[i] = move(*activeTickets.findClosing(ticketIds[i]));
+                activeTickets.release(ticketIds[i]);
+                dropVehicleLocked(tickets[i]);
+            }
+        }
+
+        // group the spots by floor, one lock per floor
+        vector<pair<ParkingFloor *, uint32_t>> toFree;
+        Ticks now = clock->now();
+        for (Ticket &ticket : tickets)
+        {
+            if (SpotView spot = ticket.getParkingSpot())
+            {
+                ticket.closeTicket(now);
+                toFree.push_back({spot.getFloor(), spot.getIndex()});
+            }
+        }
+        sort(toFree.begin(), toFree.end());
+        vector<uint32_t> floorSpots;
+        for (size_t i = 0; i < toFree.size();)
+        {
+            ParkingFloor *floor = toFree[i].first;
+            floorSpots.clear();
+            for (; i < toFree.size() and toFree[i].first == floor; i++)
+                floorSpots.push_back(toFree[i].second);
+            floor->removeVehicles(floorSpots);
+        }
+
+        // price the whole batch in one call
+        vector<Ticks> entries, exits;
+        vector<VehicleType> types;
+        vector<size_t> positions;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!tickets[i].getParkingSpot())
+                continue;
+            entries.push_back(tickets[i].getEntryTime());
+            exits.push_back(tickets[i].getExitTime());
+            types.push_back(tickets[i].getVehicleType());
+            positions.push_back(i);
+        }
+        vector<double> prices(positions.size());
+        pricingStrategy->calculatePrices(entries.data(), exits.data(), types.data(), prices.data(), prices.size());
+        for (size_t k = 0; k < positions.size(); k++)
+        {
+            amounts[positions[k]] = prices[k];
+            payment.pay(prices[k]);
+        }
+        return amounts;
+    }
+};
+
+// Many lots (one per site, or one per core for a big site) in one process.
+// A vehicle is routed to a shard by consistent hashing of its id (adding a shard moves only ~1/N of
+// the keys), its ticket id carries the shard number, so unpark goes straight to the owning lot.
+// Each shard keeps its own locks; shards never contend with each other.
+class ShardedParkingLot
+{
+private:
+    static const int VIRTUAL_NODES = 64; // ring points per shard, evens out the key distribution
+    static const size_t MAX_SHARDS = 256; // 8 shard bits in the TicketId
+
+    vector<unique_ptr<ParkingLot>> shards; // set up before traffic starts
+    vector<pair<uint64_t, uint32_t>> ring; // (point on the ring, shard), sorted
+
+    static uint64_t mix(uint64_t x) // splitmix64 finalizer
+    {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static TicketId toGlobal(TicketId local, uint32_t shard)
+    {
+        return local == INVALID_TICKET ? INVALID_TICKET : local | (static_cast<TicketId>(shard) << SHARD_SHIFT);
+    }
+
+    static TicketId toLocal(TicketId global)
+    {
+        return global & ((TicketId(1) << SHARD_SHIFT) - 1);
+    }
+
+public:
+    // returns the shard number, -1 when all shard numbers are taken
+    int addShard(unique_ptr<ParkingLot> lot)
+    {
+        if (shards.size() == MAX_SHARDS)
+            return -1;
+        uint32_t shard = static_cast<uint32_t>(shards.size());
+        shards.push_back(move(lot));
+        for (int v = 0; v < VIRTUAL_NODES; v++)
+            ring.push_back({mix((static_cast<uint64_t>(shard) << 32) | v), shard});
+        sort(ring.begin(), ring.end());
+        return static_cast<int>(shard);
+    }
+
+    size_t getShardCount() const
+    {
+        return shards.size();
+    }
+
+    ParkingLot &getShard(uint32_t shard)
+    {
+        return *shards[shard];
+    }
+
+    // first ring point clockwise from the key's hash
+    uint32_t route(const string &vehicleId) const
+    {
+        uint64_t point = mix(hash<string>()(vehicleId));
+        auto it = lower_bound(ring.begin(), ring.end(), make_pair(point, uint32_t(0)));
+        return it == ring.end() ? ring.front().second : it->second;
+    }
+
+    TicketId parkVehicle(const Vehicle &vehicle, size_t gate = 0)
+    {
+        uint32_t shard = route(vehicle.getVehicleId());
+        return toGlobal(shards[shard]->parkVehicle(vehicle, gate), shard);
+    }
+
+    // site-based deployments: the gate already knows its lot
+    TicketId parkVehicleAt(uint32_t shard, const Vehicle &vehicle, size_t gate = 0)
+    {
+        if (shard >= shards.size())
+            return INVALID_TICKET;
+        return toGlobal(shards[shard]->parkVehicle(vehicle, gate), shard);
+    }
+
+    double unparkVehicle(TicketId ticketId, PaymentMethod &payment)
+    {
+        uint32_t shard = ticketShard(ticketId);
+        if (ticketId == INVALID_TICKET or shard >= shards.size())
+            return 0.0; // invalid ticket
+        return shards[shard]->unparkVehicle(toLocal(ticketId), payment);
+    }
+
+    uint32_t getFreeSpots(SpotType type) const
+    {
+        uint32_t total = 0;
+        for (auto &lot : shards)
+            total += lot->getFreeSpots(type);
+        return total;
+    }
+};
+
+class NoOpPayment : public PaymentMethod
+{
+public:
+    bool pay(double) override
+    {
+        return true;
+    }
+};
+
+// Discrete-event load simulator: replays an arrival/departure trace against a ParkingLot on a
+// VirtualClock (hours of traffic run in milliseconds, same seed -> same trace -> same result)
+// and reports wall-clock latency of every park/unpark call plus occupancy over virtual time.
+struct TraceArrival
+{
+    Ticks arrival = 0; // virtual time from the start
+    Ticks dwell = 0;   // how long the vehicle stays
+    VehicleType type = VehicleType::CAR;
+};
+
+struct SimulationConfig
+{
+    double arrivalsPerHour = 600;            // Poisson arrivals
+    double hours = 24;                       // virtual duration
+    double meanDwellMinutes = 120;           // lognormal dwell times with this mean
+    double dwellSigma = 0.8;                 // lognormal shape, larger = longer tail
+    double typeMix[3] = {0.2, 0.65, 0.15};   // bike, car, truck
+    Ticks occupancySample = 15 * 60 * TICKS_PER_SECOND; // occupancy curve resolution
+    uint64_t seed = 1;
+};
+
+struct SimulationReport
+{
+    size_t arrivals = 0;
+    size_t parked = 0;
+    size_t rejected = 0;
+    size_t departures = 0;
+    double wallSeconds = 0;
+    double eventsPerSecond = 0;
+    double parkP50 = 0, parkP99 = 0, parkP999 = 0; // ns
+    double unparkP50 = 0, unparkP99 = 0, unparkP999 = 0;
+    vector<pair<Ticks, uint32_t>> occupancy; // (virtual time, occupied spots)
+
+    void print(ostream &out) const
+    {
+        out << "  arrivals " << arrivals << ", parked " << parked << ", rejected " << rejected
+            << ", departures " << departures << "\n"
+            << "  throughput " << eventsPerSecond / 1e6 << " M events/s (" << wallSeconds << " s wall)\n"
+            << "  park   p50/p99/p999 " << parkP50 << " / " << parkP99 << " / " << parkP999 << " ns\n"
+            << "  unpark p50/p99/p999 " << unparkP50 << " / " << unparkP99 << " / " << unparkP999 << " ns\n";
+        out << "  occupancy:";
+        size_t step = max<size_t>(1, occupancy.size() / 12);
+        for (size_t i = 0; i < occupancy.size(); i += step)
+            out << " " << occupancy[i].first / TICKS_PER_HOUR << "h=" << occupancy[i].second;
+        out << "\n";
+    }
+};
+
+class ParkingSimulator
+{
+private:
+    struct Event
+    {
+        Ticks time;
+        uint64_t sequence; // tie-break, keeps the order deterministic
+        bool departure;
+        size_t arrival; // index into the trace
+
+        bool operator>(const Event &other) const
+        {
+            return time != other.time ? time > other.time : sequence > other.sequence;
+        }
+    };
+
+    static double percentile(vector<double> &samples, double p)
+    {
+        if (samples.empty())
+            return 0;
+        size_t k = min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+        nth_element(samples.begin(), samples.begin() + k, samples.end());
+        return samples[k];
+    }
+
+public:
+    static vector<TraceArrival> generateTrace(const SimulationConfig &config)
+    {
+        mt19937_64 rng(config.seed);
+        exponential_distribution<double> gap(config.arrivalsPerHour / TICKS_PER_HOUR);
+        // lognormal with the requested mean: mu = ln(mean) - sigma^2 / 2
+        double mu = log(config.meanDwellMinutes * 60.0 * TICKS_PER_SECOND) - config.dwellSigma * config.dwellSigma / 2;
+        lognormal_distribution<double> dwell(mu, config.dwellSigma);
+        discrete_distribution<int> type({config.typeMix[0], config.typeMix[1], config.typeMix[2]});
+
+        vector<TraceArrival> trace;
+        double t = 0;
+        double end = config.hours * TICKS_PER_HOUR;
+        while ((t += gap(rng)) < end)
+        {
+            TraceArrival arrival;
+            arrival.arrival = static_cast<Ticks>(t);
+            arrival.dwell = max<Ticks>(60 * TICKS_PER_SECOND, static_cast<Ticks>(dwell(rng)));
+            arrival.type = static_cast<VehicleType>(type(rng));
+            trace.push_back(arrival);
+        }
+        return trace;
+    }
+
+    // lot must run on `clock`; every departure is played out, also those after the last arrival,
+    // so none of the simulated vehicles is left inside at the end (departures == parked)
+    static SimulationReport run(ParkingLot &lot, VirtualClock &clock, const vector<TraceArrival> &trace,
+                                Ticks occupancySample = 15 * 60 * TICKS_PER_SECOND)
+    {
+        SimulationReport report;
+        // vehicles not inside, reused so the same plate is never parked twice at once
+        vector<shared_ptr<Vehicle>> idle[3];
+        size_t fleetSize[3] = {0, 0, 0};
+
+        priority_queue<Event, vector<Event>, greater<Event>> events;
+        uint64_t sequence = 0;
+        for (size_t i = 0; i < trace.size(); i++)
+            events.push({trace[i].arrival, sequence++, false, i});
+
+        vector<TicketId> tickets(trace.size(), INVALID_TICKET);
+        vector<shared_ptr<Vehicle>> inside(trace.size());
+        vector<double> parkNs, unparkNs;
+        parkNs.reserve(trace.size());
+        unparkNs.reserve(trace.size());
+        NoOpPayment payment;
+        Ticks nextSample = 0;
+        uint32_t occupied = 0;
+
+        auto wallStart = chrono::steady_clock::now();
+        while (!events.empty())
+        {
+            Event event = events.top();
+            events.pop();
+            while (event.time >= nextSample)
+            {
+                report.occupancy.push_back({nextSample, occupied});
+                nextSample += occupancySample;
+            }
+            clock.set(event.time);
+
+            const TraceArrival &arrival = trace[event.arrival];
+            if (!event.departure)
+            {
+                report.arrivals++;
+                int type = static_cast<int>(arrival.type);
+                if (idle[type].empty())
+                    idle[type].push_back(VehicleFactory::createVehicle("SIM" + to_string(type) + "_" + to_string(fleetSize[type]++), arrival.type));
+                auto t0 = chrono::steady_clock::now();
+                TicketId ticket = lot.parkVehicle(*idle[type].back());
+                parkNs.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count());
+                if (ticket == INVALID_TICKET)
+                {
+                    report.rejected++;
+                    continue;
+                }
+                report.parked++;
+                occupied++;
+                tickets[event.arrival] = ticket;
+                inside[event.arrival] = move(idle[type].back());
+                idle[type].pop_back();
+                events.push({event.time + arrival.dwell, sequence++, true, event.arrival});
+            }
+            else
+            {
+                auto t0 = chrono::steady_clock::now();
+                lot.unparkVehicle(tickets[event.arrival], payment);
+                unparkNs.push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count());
+                idle[static_cast<int>(arrival.type)].push_back(move(inside[event.arrival]));
+                report.departures++;
+                occupied--;
+            }
+        }
+        report.wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+        report.eventsPerSecond = (report.arrivals + report.departures) / max(report.wallSeconds, 1e-9);
+        report.parkP50 = percentile(parkNs, 0.5);
+        report.parkP99 = percentile(parkNs, 0.99);
+        report.parkP999 = percentile(parkNs, 0.999);
+        report.unparkP50 = percentile(unparkNs, 0.5);
+        report.unparkP99 = percentile(unparkNs, 0.99);
+        report.unparkP999 = percentile(unparkNs, 0.999);
+        return report;
+    }
+};
+
+// Benchmarks, run as: ./main bench
+
+// keeps the compiler from hoisting/deleting the measured work (gcc/clang)
+template <typename T>
+void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Worst case for the scan: only the spot at the end of the floor is free.
+void benchmarkSpotIndex()
+{
+    cout << "findAvailableSpot: free-list index vs linear scan\n";
+    for (int n : {1000, 10000, 100000})
+    {
+        ParkingFloor floor(1);
+        for (int i = 0; i < n; i++)
+            floor.addSpot(ParkingSpotFactory::createSpot("S" + to_string(i), SpotType::CAR));
+        // free-list is LIFO, so the first spot handed out is the last one on the floor: free it again
+        SpotView lastOnFloor = floor.parkVehicle(VehicleType::CAR);
+        for (int i = 1; i < n; i++)
+            floor.parkVehicle(VehicleType::CAR);
+        floor.removeVehicle(lastOnFloor.getIndex());
+
+        const int rounds = 2000;
+        size_t found = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            SpotView spot = floor.findAvailableSpot(VehicleType::CAR);
+            doNotOptimize(spot);
+            found += static_cast<bool>(spot);
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            SpotView spot = floor.findAvailableSpotLinear(VehicleType::CAR);
+            doNotOptimize(spot);
+            found += static_cast<bool>(spot);
+        }
+        auto t2 = chrono::steady_clock::now();
+
+        double indexNs = chrono::duration<double, nano>(t1 - t0).count() / rounds;
+        double scanNs = chrono::duration<double, nano>(t2 - t1).count() / rounds;
+        cout << "  spots=" << n << "  index=" << indexNs << " ns  scan=" << scanNs
+             << " ns  (found " << found << ")\n";
+    }
+}
+
+// availability count: one heap object per spot (old layout) vs the floor's bitsets
+void benchmarkSpotStorage()
+{
+    cout << "count free car spots: ParkingSpot objects vs structure-of-arrays floor\n";
+    for (int n : {1000, 10000, 100000})
+    {
+        vector<unique_ptr<ParkingSpot>> objects;
+        ParkingFloor floor(1);
+        for (int i = 0; i < n; i++)
+        {
+            SpotType type = i % 10 == 0 ? SpotType::TRUCK : (i % 3 == 0 ? SpotType::BIKE : SpotType::CAR);
+            objects.push_back(ParkingSpotFactory::createSpot("S" + to_string(i), type));
+            floor.addSpot(objects.back()->getSpotId(), type);
+        }
+        // half full, same spots taken in both layouts
+        for (int i = 0; i < n / 2; i++)
+            floor.parkVehicle(VehicleType::CAR);
+        for (int i = 0; i < n; i++)
+        {
+            if (floor.isOccupied(i))
+                objects[i]->parkVehicle(static_cast<VehicleHandle>(i));
+        }
+
+        const int rounds = 200;
+        size_t sumObjects = 0, sumFloor = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            size_t count = 0;
+            for (auto &spot : objects)
+                count += !spot->isOccupied() and spot->getType() == SpotType::CAR;
+            doNotOptimize(count);
+            sumObjects += count;
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            size_t count = floor.countAvailable(SpotType::CAR);
+            doNotOptimize(count);
+            sumFloor += count;
+        }
+        auto t2 = chrono::steady_clock::now();
+
+        cout << "  spots=" << n
+             << "  objects=" << chrono::duration<double, micro>(t1 - t0).count() / rounds << " us"
+             << "  soa=" << chrono::duration<double, micro>(t2 - t1).count() / rounds << " us"
+             << "  (free cars " << sumObjects / rounds << " / " << sumFloor / rounds << ")\n";
+    }
+}
+
+// every gate thread parks a car and immediately unparks it, as fast as it can
+void benchmarkGateThroughput()
+{
+    cout << "park/unpark throughput vs gate threads (8 floors x 1000 car spots)\n";
+    for (int gates : {1, 2, 4, 8, 16})
+    {
+        ParkingLot lot(make_unique<HourlyPricingStrategy>());
+        for (int f = 0; f < 8; f++)
+        {
+            auto floor = make_unique<ParkingFloor>(f);
+            for (int i = 0; i < 1000; i++)
+                floor->addSpot(ParkingSpotFactory::createSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR));
+            lot.addFloor(move(floor));
+        }
+
+        const int opsPerGate = 200000 / gates;
+        atomic<bool> go{false};
+        vector<thread> threads;
+        for (int g = 0; g < gates; g++)
+        {
+            threads.emplace_back([&, g]()
+                                 {
+                Vehicle car("Car_" + to_string(g), VehicleType::CAR);
+                NoOpPayment payment;
+                while (!go.load())
+                    this_thread::yield();
+                for (int i = 0; i < opsPerGate; i++)
+                {
+                    TicketId ticket = lot.parkVehicle(car, g);
+                    lot.unparkVehicle(ticket, payment);
+                } });
+        }
+        auto t0 = chrono::steady_clock::now();
+        go = true;
+        for (auto &t : threads)
+            t.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  gates=" << gates << "  " << (2.0 * opsPerGate * gates / secs / 1e6) << " M ops/s\n";
+    }
+}
+
+// gates keep parking while an operator takes floors offline, adds spots and disables spots
+void benchmarkHotReconfiguration()
+{
+    cout << "hot reconfiguration: gate throughput while an operator changes the layout (4 gates, 8 floors)\n";
+    for (bool reconfigure : {false, true})
+    {
+        ParkingLot lot(make_unique<HourlyPricingStrategy>());
+        for (int f = 0; f < 8; f++)
+        {
+            auto floor = make_unique<ParkingFloor>(f);
+            for (int i = 0; i < 1000; i++)
+                floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+            lot.addFloor(move(floor));
+        }
+        // cars parked on floor 7 before it goes offline keep their tickets
+        vector<TicketId> early;
+        for (int i = 0; i < 100; i++)
+            early.push_back(lot.parkVehicle(Vehicle("EARLY_" + to_string(i), VehicleType::CAR), 7));
+
+        const int gates = 4, opsPerGate = 100000;
+        atomic<bool> go{false};
+        atomic<int> running{gates};
+        vector<thread> threads;
+        for (int g = 0; g < gates; g++)
+            threads.emplace_back([&, g]()
+                                 {
+                Vehicle car("Car_" + to_string(g), VehicleType::CAR);
+                NoOpPayment payment;
+                while (!go.load())
+                    this_thread::yield();
+                for (int i = 0; i < opsPerGate; i++)
+                {
+                    TicketId ticket = lot.parkVehicle(car, g);
+                    lot.unparkVehicle(ticket, payment);
+                }
+                running--; });
+
+        vector<double> changeUs;
+        auto t0 = chrono::steady_clock::now();
+        go = true;
+        for (int round = 0; reconfigure and running.load() > 0; round++)
+        {
+            auto c0 = chrono::steady_clock::now();
+            switch (round % 4)
+            {
+            case 0:
+                lot.setFloorOpen(7, false);
+                break;
+            case 1:
+                lot.addSpot(round % 7, "EXTRA_" + to_string(round), SpotType::CAR);
+                break;
+            case 2:
+                lot.setSpotEnabled(round % 7, round % 1000, false);
+                break;
+            default:
+                lot.setFloorOpen(7, true);
+                break;
+            }
+            changeUs.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - c0).count());
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+        for (auto &t : threads)
+            t.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+        NoOpPayment payment;
+        size_t kept = 0;
+        for (TicketId ticket : early)
+            kept += lot.unparkVehicle(ticket, payment) > 0;
+        cout << "  " << (reconfigure ? "with changes   " : "static layout  ") << 2.0 * opsPerGate * gates / secs / 1e6 << " M ops/s";
+        if (reconfigure)
+        {
+            sort(changeUs.begin(), changeUs.end());
+            cout << ", " << changeUs.size() << " changes, p50 " << changeUs[changeUs.size() / 2]
+                 << " us, max " << changeUs.back() << " us";
+        }
+        cout << ", early tickets settled " << kept << "/" << early.size() << "\n";
+    }
+}
+
+// per-event cost of single calls vs batches of the same vehicles
+void benchmarkBatchPark()
+{
+    cout << "per-event cost: single park/unpark vs batch (4 floors x 10000 car spots)\n";
+    ParkingLot lot(make_unique<HourlyPricingStrategy>());
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 10000; i++)
+            floor->addSpot(ParkingSpotFactory::createSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR));
+        lot.addFloor(move(floor));
+    }
+    NoOpPayment payment;
+    const int rounds = 2000;
+
+    for (int batchSize : {1, 8, 64, 512})
+    {
+        vector<Vehicle> cars;
+        for (int i = 0; i < batchSize; i++)
+            cars.emplace_back("Car_" + to_string(i), VehicleType::CAR);
+
+        vector<TicketId> tickets(batchSize);
+        auto t0 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            for (int i = 0; i < batchSize; i++)
+                tickets[i] = lot.parkVehicle(cars[i]);
+            for (int i = 0; i < batchSize; i++)
+                lot.unparkVehicle(tickets[i], payment);
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++)
+        {
+            tickets = lot.parkVehicles(cars);
+            lot.unparkVehicles(tickets, payment);
+        }
+        auto t2 = chrono::steady_clock::now();
+
+        double events = 2.0 * rounds * batchSize;
+        cout << "  batch=" << batchSize
+             << "  single=" << chrono::duration<double, nano>(t1 - t0).count() / events << " ns/event"
+             << "  batched=" << chrono::duration<double, nano>(t2 - t1).count() / events << " ns/event\n";
+    }
+}
+
+// 1M journaled events (batches -> group commit), then rebuild a fresh lot from the log,
+// and from snapshot + empty tail
+void benchmarkRecovery()
+{
+    cout << "crash recovery from the journal (1M park/unpark events)\n";
+    const string journalPath = "bench.journal";
+    const string snapshotPath = "bench.snapshot";
+    remove(journalPath.c_str());
+    remove(snapshotPath.c_str());
+
+    auto buildLot = []()
+    {
+        auto lot = make_unique<ParkingLot>(make_unique<HourlyPricingStrategy>());
+        for (int f = 0; f < 4; f++)
+        {
+            auto floor = make_unique<ParkingFloor>(f);
+            for (int i = 0; i < 100000; i++)
+                floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+            lot->addFloor(move(floor));
+        }
+        return lot;
+    };
+
+    size_t expected;
+    {
+        auto lot = buildLot();
+        lot->enableJournal(journalPath);
+        NoOpPayment payment;
+        // one set of 500 cars per open batch (at most 402 open), a plate is never inside twice
+        vector<vector<Vehicle>> fleets(402);
+        for (size_t b = 0; b < fleets.size(); b++)
+            for (int i = 0; i < 500; i++)
+                fleets[b].emplace_back("KA" + to_string(b) + "_" + to_string(i), VehicleType::CAR);
+
+        // 600k parks, 400k unparks -> 200k cars still inside
+        vector<vector<TicketId>> open;
+        auto t0 = chrono::steady_clock::now();
+        for (int batch = 0; batch < 2000; batch++)
+        {
+            if (batch % 5 < 3)
+                open.push_back(lot->parkVehicles(fleets[open.size()]));
+            else
+            {
+                lot->unparkVehicles(open.back(), payment);
+                open.pop_back();
+            }
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        expected = open.size() * 500;
+        cout << "  logged 1M events in " << secs << " s (2000 group commits)\n";
+    }
+
+    {
+        auto lot = buildLot();
+        auto t0 = chrono::steady_clock::now();
+        size_t restored = lot->recover(snapshotPath, journalPath);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  journal replay: " << restored << " tickets (expected " << expected << ") in " << secs << " s, "
+             << lot->getFreeSpots(SpotType::CAR) << " car spots free\n";
+
+        lot->enableJournal(journalPath);
+        lot->writeSnapshot(snapshotPath);
+    }
+
+    {
+        auto lot = buildLot();
+        auto t0 = chrono::steady_clock::now();
+        size_t restored = lot->recover(snapshotPath, journalPath);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  snapshot load: " << restored << " tickets in " << secs << " s\n";
+    }
+    remove(journalPath.c_str());
+    remove(snapshotPath.c_str());
+}
+
+// fixed number of gate threads, lots split into 1..8 shards (same total spots)
+void benchmarkShardedLots()
+{
+    cout << "sharded lots: throughput vs shard count (8 gate threads, 8000 car spots in total)\n";
+    const int gates = 8;
+    for (int shardCount : {1, 2, 4, 8})
+    {
+        ShardedParkingLot lots;
+        for (int s = 0; s < shardCount; s++)
+        {
+            auto lot = make_unique<ParkingLot>(make_unique<HourlyPricingStrategy>());
+            auto floor = make_unique<ParkingFloor>(0);
+            for (int i = 0; i < 8000 / shardCount; i++)
+                floor->addSpot("S" + to_string(i), SpotType::CAR);
+            lot->addFloor(move(floor));
+            lots.addShard(move(lot));
+        }
+
+        const int opsPerGate = 100000;
+        atomic<bool> go{false};
+        vector<thread> threads;
+        for (int g = 0; g < gates; g++)
+        {
+            threads.emplace_back([&, g]()
+                                 {
+                vector<Vehicle> cars;
+                for (int i = 0; i < 64; i++)
+                    cars.emplace_back("G" + to_string(g) + "_" + to_string(i), VehicleType::CAR);
+                NoOpPayment payment;
+                while (!go.load())
+                    this_thread::yield();
+                for (int i = 0; i < opsPerGate; i++)
+                {
+                    TicketId ticket = lots.parkVehicle(cars[i % cars.size()], g);
+                    lots.unparkVehicle(ticket, payment);
+                } });
+        }
+        auto t0 = chrono::steady_clock::now();
+        go = true;
+        for (auto &t : threads)
+            t.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  shards=" << shardCount << "  " << (2.0 * opsPerGate * gates / secs / 1e6) << " M ops/s\n";
+    }
+}
+
+// Vehicle ownership on the park/unpark path, gates sharing one fleet of vehicles (season passes).
+// refcounted: what the spot and the ticket used to do, copy the shared_ptr in and drop it on unpark
+// (4 atomic read-modify-writes on a control block other gates touch too).
+// pooled: the vehicle is copied into a VehiclePool; in the lot that happens under the tickets lock
+// the gate holds anyway, so a pool per thread measures the added cost.
+void benchmarkVehicleOwnership()
+{
+    cout << "vehicle ownership: shared_ptr hand-off vs lot-owned pool (fleet of 64 shared vehicles)\n";
+    vector<shared_ptr<Vehicle>> fleet;
+    for (int i = 0; i < 64; i++)
+        fleet.push_back(VehicleFactory::createVehicle("PASS_" + to_string(i), VehicleType::CAR));
+    const int opsPerThread = 1000000;
+
+    auto runThreads = [](int count, auto body)
+    {
+        atomic<bool> go{false};
+        vector<thread> threads;
+        for (int g = 0; g < count; g++)
+            threads.emplace_back([&, g]()
+                                 {
+                while (!go.load())
+                    this_thread::yield();
+                body(g); });
+        auto t0 = chrono::steady_clock::now();
+        go = true;
+        for (auto &t : threads)
+            t.join();
+        return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    };
+
+    for (int threadCount : {1, 2, 4, 8})
+    {
+        double refcounted = runThreads(threadCount, [&](int g)
+                                       {
+            vector<shared_ptr<Vehicle>> spotRefs(16), ticketRefs(16);
+            for (int i = 0; i < opsPerThread; i++)
+            {
+                const shared_ptr<Vehicle> &vehicle = fleet[(g + i) % fleet.size()];
+                spotRefs[i % 16] = vehicle; // park, drops whatever left 16 parks ago
+                ticketRefs[i % 16] = vehicle;
+            }
+            doNotOptimize(spotRefs.data()); });
+        double pooled = runThreads(threadCount, [&](int g)
+                                   {
+            VehiclePool pool;
+            vector<VehicleHandle> spotRefs(16, NO_VEHICLE), ticketRefs(16, NO_VEHICLE);
+            for (int i = 0; i < opsPerThread; i++)
+            {
+                if (ticketRefs[i % 16] != NO_VEHICLE)
+                    pool.release(ticketRefs[i % 16]);
+                VehicleHandle handle = pool.acquire(*fleet[(g + i) % fleet.size()]);
+                spotRefs[i % 16] = handle;
+                ticketRefs[i % 16] = handle;
+            }
+            doNotOptimize(spotRefs.data()); });
+        double ops = static_cast<double>(opsPerThread) * threadCount;
+        cout << "  threads=" << threadCount << "  refcounted " << 1e9 * refcounted / ops << " ns/park"
+             << ", pooled " << 1e9 * pooled / ops << " ns/park\n";
+    }
+
+    // end to end through the lot, each gate cycling through its share of the fleet
+    ParkingLot lot(make_unique<HourlyPricingStrategy>());
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 2000; i++)
+            floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+        lot.addFloor(move(floor));
+    }
+    const int gates = 8, opsPerGate = 100000;
+    double secs = runThreads(gates, [&](int g)
+                             {
+        NoOpPayment payment;
+        for (int i = 0; i < opsPerGate; i++)
+        {
+            TicketId ticket = lot.parkVehicle(*fleet[g + gates * (i % 8)], g);
+            lot.unparkVehicle(ticket, payment);
+        } });
+    cout << "  ParkingLot, " << gates << " gates: " << 2.0 * opsPerGate * gates / secs / 1e6 << " M ops/s\n";
+}
+
+// end-of-day settlement: per-ticket virtual calls vs one batch call
+void benchmarkBatchPricing()
+{
+    cout << "settlement pricing: per-ticket virtual call vs batch (500k tickets)\n";
+    const size_t n = 500000;
+    vector<Ticks> entries(n), exits(n);
+    vector<VehicleType> types(n);
+    uint64_t seed = 42;
+    for (size_t i = 0; i < n; i++)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        entries[i] = 1700000000 * TICKS_PER_SECOND + static_cast<Ticks>(seed >> 34);
+        exits[i] = entries[i] + static_cast<Ticks>((seed >> 20) % (12 * TICKS_PER_HOUR));
+        types[i] = static_cast<VehicleType>((seed >> 8) % 3);
+    }
+    unique_ptr<PricingStrategy> pricing = make_unique<HourlyPricingStrategy>();
+    vector<double> single(n), batch(n);
+
+    const int rounds = 20;
+    auto t0 = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (size_t i = 0; i < n; i++)
+            single[i] = pricing->calculatePrice(entries[i], exits[i], types[i]);
+        doNotOptimize(single.data());
+    }
+    auto t1 = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        pricing->calculatePrices(entries.data(), exits.data(), types.data(), batch.data(), n);
+        doNotOptimize(batch.data());
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    double mismatches = 0;
+    for (size_t i = 0; i < n; i++)
+        mismatches += single[i] != batch[i];
+    cout << "  virtual=" << chrono::duration<double, nano>(t1 - t0).count() / (rounds * n) << " ns/ticket"
+         << "  batch=" << chrono::duration<double, nano>(t2 - t1).count() / (rounds * n) << " ns/ticket"
+         << "  (mismatches " << mismatches << ")\n";
+}
+
+// quote latency of the dynamic pricing engine while gates park/unpark against the same lot
+void benchmarkDynamicPricing()
+{
+    cout << "dynamic pricing: quote latency under gate load, surge vs occupancy\n";
+    TariffTable tariffs;
+    tariffs.setDailyRate(VehicleType::CAR, 8, 20, 30.0).setRate(VehicleType::CAR, 5, 0, 24, 15.0);
+    auto owned = make_unique<DynamicPricingStrategy>(tariffs);
+    DynamicPricingStrategy *pricing = owned.get();
+    ParkingLot lot(move(owned));
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 250; i++)
+            floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+        lot.addFloor(move(floor));
+    }
+
+    // flat tariff without surge must price like HourlyPricingStrategy
+    DynamicPricingStrategy flat(TariffTable(), {});
+    HourlyPricingStrategy hourly;
+    size_t mismatches = 0;
+    for (Ticks stay = 0; stay < 200 * TICKS_PER_HOUR; stay += 7 * 60 * TICKS_PER_SECOND)
+        mismatches += flat.calculatePrice(1000, 1000 + stay, VehicleType::TRUCK) != hourly.calculatePrice(1000, 1000 + stay, VehicleType::TRUCK);
+    cout << "  flat tariff vs hourly: " << mismatches << " mismatches\n";
+
+    // fill step by step, the multiplier follows without any quote doing the work
+    vector<TicketId> parked;
+    for (int percent : {50, 75, 90, 97})
+    {
+        while (parked.size() < 10u * percent)
+            parked.push_back(lot.parkVehicle(Vehicle("FILL_" + to_string(parked.size()), VehicleType::CAR)));
+        cout << "  occupancy " << 100.0 * pricing->getOccupancy(SpotType::CAR) << "% -> surge x"
+             << pricing->getSurge(SpotType::CAR) << "\n";
+    }
+    NoOpPayment payment;
+    while (parked.size() > 800)
+    {
+        lot.unparkVehicle(parked.back(), payment);
+        parked.pop_back();
+    }
+
+    // 4 gates churn around 80-83% occupancy (crossing the 1.25/1.5 steps), 2 threads quote
+    atomic<bool> stop{false};
+    vector<thread> gates;
+    for (int g = 0; g < 4; g++)
+        gates.emplace_back([&, g]()
+                           {
+            vector<TicketId> mine;
+            int i = 0;
+            while (!stop.load(memory_order_relaxed))
+            {
+                if (mine.size() < 12)
+                    mine.push_back(lot.parkVehicle(Vehicle("G" + to_string(g) + "_" + to_string(i++ % 64), VehicleType::CAR), g));
+                else
+                {
+                    for (TicketId ticket : mine)
+                        lot.unparkVehicle(ticket, payment);
+                    mine.clear();
+                }
+            }
+            for (TicketId ticket : mine)
+                lot.unparkVehicle(ticket, payment); });
+
+    const int rounds = 2000, perRound = 500;
+    vector<double> roundNs[2];
+    vector<thread> quoters;
+    for (int q = 0; q < 2; q++)
+        quoters.emplace_back([&, q]()
+                             {
+            Ticks entry = 1700000000LL * TICKS_PER_SECOND;
+            double sum = 0;
+            for (int r = 0; r < rounds; r++)
+            {
+                auto t0 = chrono::steady_clock::now();
+                for (int i = 0; i < perRound; i++)
+                    sum += pricing->calculatePrice(entry, entry + (i * 977 + r) * 60 * TICKS_PER_SECOND, VehicleType::CAR);
+                roundNs[q].push_back(chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / perRound);
+            }
+            doNotOptimize(sum); });
+    for (auto &t : quoters)
+        t.join();
+    stop = true;
+    for (auto &t : gates)
+        t.join();
+    vector<double> all(roundNs[0]);
+    all.insert(all.end(), roundNs[1].begin(), roundNs[1].end());
+    sort(all.begin(), all.end());
+    cout << "  quote: p50 " << all[all.size() / 2] << " ns, p99 " << all[all.size() * 99 / 100]
+         << " ns (averaged over " << perRound << " quotes, 2 quoting threads + 4 gates)\n";
+}
+
+// Same random arrival/departure sequence against each policy, arrivals spread over 4 gates (gate g
+// starts on floor g). Spot types are shuffled along the walking distance and every floor has its own
+// distance from the entrance, so the policies pick different spots. What each one should win on:
+//   first-fit       nothing in particular: stays on the gate's floor and upsizes there when it fills
+//   best-fit        fewest vehicles in a bigger spot than they need -> fewest truck rejections
+//   nearest         shortest average walk, at the price of upsizing near the entrance
+//   floor-balancing smallest gap between the fullest and the emptiest floor
+void benchmarkAllocationPolicies()
+{
+    cout << "allocation policies (4 floors x 230 spots, types mixed along the distance, 4 gates, 200k arrivals)\n";
+    const int floorCount = 4, gates = 4;
+    const uint32_t entranceDistance[floorCount] = {40, 0, 90, 25}; // entrance of floor f, in spot lengths
+
+    // one layout for every policy: per floor 50 bike, 150 car, 30 truck spots in a shuffled order
+    vector<vector<SpotType>> layout(floorCount);
+    mt19937 shuffler(11);
+    for (int f = 0; f < floorCount; f++)
+    {
+        layout[f].insert(layout[f].end(), 50, SpotType::BIKE);
+        layout[f].insert(layout[f].end(), 150, SpotType::CAR);
+        layout[f].insert(layout[f].end(), 30, SpotType::TRUCK);
+        shuffle(layout[f].begin(), layout[f].end(), shuffler);
+    }
+
+    auto run = [&](const string &name, unique_ptr<SpotAllocationPolicy> policy)
+    {
+        ParkingLot lot(make_unique<HourlyPricingStrategy>());
+        lot.setAllocationPolicy(move(policy));
+        uint32_t totalSpots = 0;
+        for (int f = 0; f < floorCount; f++)
+        {
+            auto floor = make_unique<ParkingFloor>(f);
+            for (uint32_t i = 0; i < layout[f].size(); i++)
+                floor->addSpot("F" + to_string(f) + "S" + to_string(i), layout[f][i], entranceDistance[f] + i);
+            totalSpots += static_cast<uint32_t>(layout[f].size());
+            lot.addFloor(move(floor));
+        }
+
+        // vehicles not inside; a type never has more inside than the lot has spots
+        vector<shared_ptr<Vehicle>> idle[3];
+        for (int t = 0; t < 3; t++)
+            for (size_t i = 0; i <= totalSpots; i++)
+                idle[t].push_back(VehicleFactory::createVehicle("V" + to_string(t) + "_" + to_string(i), static_cast<VehicleType>(t)));
+
+        NoOpPayment payment;
+        vector<TicketId> parked;
+        vector<pair<int, shared_ptr<Vehicle>>> parkedVehicles;
+        uint64_t seed = 7;
+        auto next = [&seed]()
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            return seed >> 33;
+        };
+        size_t arrivals[3] = {0, 0, 0}, rejected[3] = {0, 0, 0};
+        size_t admitted = 0, upsized = 0, imbalanceSamples = 0;
+        double occupancySum = 0, distanceSum = 0, imbalanceSum = 0, parkNs = 0;
+        const int steps = 200000;
+        for (int step = 0; step < steps; step++)
+        {
+            // 20% bikes, 65% cars, 15% trucks; departures keep the lot around 90% full
+            uint64_t roll = next() % 100;
+            int type = roll < 20 ? 0 : (roll < 85 ? 1 : 2);
+            arrivals[type]++;
+            auto t0 = chrono::steady_clock::now();
+            TicketId ticket = lot.parkVehicle(*idle[type].back(), step % gates);
+            parkNs += chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+            if (ticket == INVALID_TICKET)
+                rejected[type]++;
+            else
+            {
+                VehicleLocation location;
+                lot.findVehicle(idle[type].back()->getVehicleId(), location);
+                distanceSum += entranceDistance[location.floorNumber] + location.spotIndex;
+                upsized += static_cast<int>(layout[location.floorNumber][location.spotIndex]) > type;
+                admitted++;
+                parked.push_back(ticket);
+                parkedVehicles.emplace_back(type, move(idle[type].back()));
+                idle[type].pop_back();
+            }
+            while (parked.size() > totalSpots * 0.9 or (parked.size() > 0 and next() % 100 < 45))
+            {
+                size_t pick = next() % parked.size();
+                lot.unparkVehicle(parked[pick], payment);
+                idle[parkedVehicles[pick].first].push_back(move(parkedVehicles[pick].second));
+                parked[pick] = parked.back();
+                parked.pop_back();
+                parkedVehicles[pick] = move(parkedVehicles.back());
+                parkedVehicles.pop_back();
+                if (next() % 100 >= 45)
+                    break;
+            }
+            occupancySum += static_cast<double>(parked.size()) / totalSpots;
+            if (step % 16 == 0)
+            {
+                // occupied share of the fullest minus the emptiest floor
+                double fullest = 0, emptiest = 1;
+                for (const FloorAvailability &floor : lot.getAvailability())
+                {
+                    uint32_t total = 0, occupied = 0;
+                    for (int t = 0; t < 3; t++)
+                    {
+                        total += floor.totalSpots[t];
+                        occupied += floor.occupiedSpots(static_cast<SpotType>(t));
+                    }
+                    double share = static_cast<double>(occupied) / total;
+                    fullest = max(fullest, share);
+                    emptiest = min(emptiest, share);
+                }
+                imbalanceSum += fullest - emptiest;
+                imbalanceSamples++;
+            }
+        }
+        cout << "  " << name << ": utilization " << 100.0 * occupancySum / steps << "%"
+             << ", rejected bike " << 100.0 * rejected[0] / arrivals[0] << "%"
+             << " car " << 100.0 * rejected[1] / arrivals[1] << "%"
+             << " truck " << 100.0 * rejected[2] / arrivals[2] << "%"
+             << ", upsized " << 100.0 * upsized / admitted << "%"
+             << ", walk " << distanceSum / admitted
+             << ", floor gap " << 100.0 * imbalanceSum / imbalanceSamples << "%"
+             << ", " << parkNs / steps << " ns/park\n";
+    };
+    run("first-fit      ", make_unique<FirstFitPolicy>());
+    run("best-fit       ", make_unique<BestFitPolicy>());
+    run("nearest        ", make_unique<NearestToEntrancePolicy>());
+    run("floor-balancing", make_unique<FloorBalancingPolicy>());
+}
+
+// stand-in for a remote gateway: every call takes `delay`, every `failEvery`-th call fails
+class SlowPayment : public PaymentMethod
+{
+private:
+    chrono::microseconds delay;
+    int failEvery;
+    atomic<int> calls{0};
+
+public:
+    SlowPayment(chrono::microseconds d, int fail = 0) : delay(d), failEvery(fail) {}
+
+    bool pay(double) override
+    {
+        this_thread::sleep_for(delay);
+        int call = ++calls;
+        return failEvery == 0 or call % failEvery != 0;
+    }
+};
+
+// 4 gates unparking against a 2 ms payment gateway: synchronous pay vs the async pipeline
+void benchmarkAsyncPayments()
+{
+    cout << "unpark with a 2 ms payment method (4 gates x 200 cars, 1 in 10 payments fails once)\n";
+    auto run = [](bool async)
+    {
+        ParkingLot lot(make_unique<HourlyPricingStrategy>());
+        auto floor = make_unique<ParkingFloor>(0);
+        for (int i = 0; i < 1000; i++)
+            floor->addSpot("S" + to_string(i), SpotType::CAR);
+        lot.addFloor(move(floor));
+        if (async)
+            lot.enableAsyncPayments(16, 3, chrono::milliseconds(1));
+        auto gateway = make_shared<SlowPayment>(chrono::microseconds(2000), 10);
+
+        const int gates = 4, perGate = 200;
+        vector<vector<TicketId>> tickets(gates);
+        for (int g = 0; g < gates; g++)
+            for (int i = 0; i < perGate; i++)
+                tickets[g].push_back(lot.parkVehicle(Vehicle("C" + to_string(g * perGate + i), VehicleType::CAR), g));
+
+        atomic<long long> gateNs{0};
+        atomic<int> paid{0};
+        auto t0 = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (int g = 0; g < gates; g++)
+        {
+            threads.emplace_back([&, g]()
+                                 {
+                vector<future<PaymentResult>> pending;
+                for (TicketId ticket : tickets[g])
+                {
+                    auto start = chrono::steady_clock::now();
+                    if (async)
+                        pending.push_back(lot.unparkVehicleAsync(ticket, gateway));
+                    else
+                        lot.unparkVehicle(ticket, *gateway); // no retry on this path
+                    gateNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+                }
+                for (auto &result : pending)
+                    paid += result.get().paid; });
+        }
+        for (auto &t : threads)
+            t.join();
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "  " << (async ? "async" : "sync ") << ": gate blocked " << gateNs / (gates * perGate) / 1000.0
+             << " us/unpark, all " << gates * perGate << " settled in " << secs << " s";
+        if (async)
+            cout << " (" << paid << " paid after retries)";
+        cout << "\n";
+    };
+    run(false);
+    run(true);
+}
+
+// 100k+ outstanding bookings over 30 days: calendar tree vs scanning the bookings
+void benchmarkReservations()
+{
+    cout << "reservations: 150k bookings over 30 days, 15 minute buckets\n";
+    auto clock = make_shared<VirtualClock>(0);
+    ParkingLot lot(make_unique<HourlyPricingStrategy>(), clock);
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 2500; i++)
+            floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+        lot.addFloor(move(floor));
+    }
+    const Ticks bucket = 15 * 60 * TICKS_PER_SECOND;
+    const int buckets = 30 * 24 * 4;
+    lot.enableReservations(0, bucket, buckets, 2 * TICKS_PER_HOUR);
+
+    uint64_t seed = 3;
+    auto next = [&seed]()
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return seed >> 33;
+    };
+    auto randomWindow = [&](Ticks &from, Ticks &to)
+    {
+        from = static_cast<Ticks>(next() % (buckets - 48)) * bucket;
+        to = from + static_cast<Ticks>(1 + next() % 16) * bucket;
+    };
+
+    vector<Reservation> plain; // same bookings as a flat list, for the scan comparison
+    const int count = 150000;
+    size_t accepted = 0;
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        Ticks from, to;
+        randomWindow(from, to);
+        if (lot.reserveSpot("V" + to_string(i), SpotType::CAR, from, to) != INVALID_RESERVATION)
+        {
+            accepted++;
+            plain.push_back(Reservation{"", SpotType::CAR, from, to});
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    cout << "  reserve: " << chrono::duration<double, nano>(t1 - t0).count() / count << " ns/booking ("
+         << accepted << " accepted)\n";
+
+    const int queries = 2000;
+    int64_t sumTree = 0, sumScan = 0;
+    vector<pair<Ticks, int>> points;
+    seed = 99;
+    t0 = chrono::steady_clock::now();
+    for (int q = 0; q < queries; q++)
+    {
+        Ticks from, to;
+        randomWindow(from, to);
+        sumTree += lot.getBookableSpots(SpotType::CAR, from, to);
+    }
+    t1 = chrono::steady_clock::now();
+    seed = 99;
+    for (int q = 0; q < queries; q++)
+    {
+        // without the calendar: peak overlap of all bookings within the window (sweep)
+        Ticks from, to;
+        randomWindow(from, to);
+        points.clear();
+        for (const Reservation &r : plain)
+        {
+            if (r.from < to and from < r.to)
+            {
+                points.push_back({max(r.from, from), +1});
+                points.push_back({min(r.to, to), -1});
+            }
+        }
+        sort(points.begin(), points.end());
+        int current = 0, peak = 0;
+        for (auto &point : points)
+            peak = max(peak, current += point.second);
+        sumScan += max(0, 10000 - peak);
+    }
+    auto t2 = chrono::steady_clock::now();
+    cout << "  availability query: calendar " << chrono::duration<double, nano>(t1 - t0).count() / queries
+         << " ns, scan " << chrono::duration<double, nano>(t2 - t1).count() / queries << " ns"
+         << " (avg bookable " << sumTree / queries << " / " << sumScan / queries << ")\n";
+}
+
+// heap bytes of a std container, for the memory-per-vehicle comparison
+template <typename T>
+struct CountingAllocator
+{
+    using value_type = T;
+    size_t *bytes;
+
+    explicit CountingAllocator(size_t *b) : bytes(b) {}
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &other) : bytes(other.bytes) {}
+
+    T *allocate(size_t n)
+    {
+        *bytes += n * sizeof(T);
+        return allocator<T>().allocate(n);
+    }
+    void deallocate(T *p, size_t n)
+    {
+        *bytes -= n * sizeof(T);
+        allocator<T>().deallocate(p, n);
+    }
+    template <typename U>
+    bool operator==(const CountingAllocator<U> &other) const { return bytes == other.bytes; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U> &other) const { return bytes != other.bytes; }
+};
+
+// "where is my car": VehicleIndex vs unordered_map<string, TicketId>, then through the lot
+void benchmarkVehicleIndex()
+{
+    cout << "vehicle lookup index (1M plates)\n";
+    const int count = 1000000;
+    vector<string> plates;
+    for (int i = 0; i < count; i++)
+        plates.push_back("KA" + to_string(10 + i % 90) + "MH" + to_string(100000 + i));
+    vector<uint32_t> order(count);
+    for (int i = 0; i < count; i++)
+        order[i] = static_cast<uint32_t>((i * 2654435761ULL) % count); // scattered probes
+
+    auto lookups = [&](auto find)
+    {
+        auto t0 = chrono::steady_clock::now();
+        uint64_t sum = 0;
+        for (uint32_t i : order)
+            sum += find(plates[i]);
+        doNotOptimize(sum);
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / count;
+    };
+
+    VehicleIndex index;
+    for (int i = 0; i < count; i++)
+        index.insert(plates[i], static_cast<TicketId>(i));
+    double indexNs = lookups([&](const string &plate)
+                             { return index.find(plate); });
+
+    size_t mapBytes = 0;
+    using CountingMap = unordered_map<string, TicketId, hash<string>, equal_to<string>, CountingAllocator<pair<const string, TicketId>>>;
+    CountingMap map(0, hash<string>(), equal_to<string>(), CountingAllocator<pair<const string, TicketId>>(&mapBytes));
+    for (int i = 0; i < count; i++)
+        map.emplace(plates[i], static_cast<TicketId>(i));
+    double mapNs = lookups([&](const string &plate)
+                           { return map.find(plate)->second; });
+
+    size_t duplicates = 0;
+    for (int i = 0; i < count; i += 10)
+        duplicates += !index.insert(plates[i], INVALID_TICKET);
+
+    cout << "  VehicleIndex " << indexNs << " ns/lookup, " << static_cast<double>(index.memoryBytes()) / count << " B/vehicle\n"
+         << "  unordered_map " << mapNs << " ns/lookup, " << static_cast<double>(mapBytes) / count << " B/vehicle"
+         << " (ids in SSO, longer plates add a heap block each)\n"
+         << "  duplicate entries rejected: " << duplicates << " / " << count / 10 << "\n";
+
+    // through the lot: single lookups vs one bulk query under one lock
+    ParkingLot lot(make_unique<HourlyPricingStrategy>());
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 25000; i++)
+            floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+        lot.addFloor(move(floor));
+    }
+    vector<string> inside(plates.begin(), plates.begin() + 100000);
+    for (const string &plate : inside)
+        lot.parkVehicle(Vehicle(plate, VehicleType::CAR));
+    auto t0 = chrono::steady_clock::now();
+    VehicleLocation location;
+    size_t found = 0;
+    for (const string &plate : inside)
+        found += lot.findVehicle(plate, location);
+    auto t1 = chrono::steady_clock::now();
+    vector<VehicleLocation> locations = lot.findVehicles(inside);
+    auto t2 = chrono::steady_clock::now();
+    doNotOptimize(locations.data());
+    cout << "  ParkingLot::findVehicle " << chrono::duration<double, nano>(t1 - t0).count() / inside.size() << " ns"
+         << ", findVehicles (bulk) " << chrono::duration<double, nano>(t2 - t1).count() / inside.size() << " ns/vehicle"
+         << " (" << found << " found)\n";
+}
+
+// cost of reading "now" on the hot path
+void benchmarkClocks()
+{
+    cout << "clock read cost\n";
+    const int rounds = 5000000;
+    auto measure = [&](const string &name, auto read)
+    {
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++)
+        {
+            auto value = read();
+            doNotOptimize(value);
+        }
+        cout << "  " << name << " " << chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / rounds << " ns\n";
+    };
+    auto system = make_shared<SystemClock>();
+    CachedClock cached(system);
+    VirtualClock virtualClock;
+    Clock *systemClock = system.get(), *cachedClock = &cached, *simulated = &virtualClock;
+    measure("time(nullptr)        ", []()
+            { return time(nullptr); });
+    measure("chrono::system_clock ", []()
+            { return chrono::system_clock::now(); });
+    measure("SystemClock (coarse) ", [&]()
+            { return systemClock->now(); });
+    measure("CachedClock          ", [&]()
+            { return cachedClock->now(); });
+    measure("VirtualClock         ", [&]()
+            { return simulated->now(); });
+}
+
+// what the instrumentation sees under gate load, and what it costs per park/unpark
+// (compare with a build using -DPARKING_METRICS=0)
+void benchmarkMetrics()
+{
+    cout << "metrics: " << (PARKING_METRICS ? "compiled in" : "compiled out") << "\n";
+    auto buildLot = []()
+    {
+        auto lot = make_unique<ParkingLot>(make_unique<HourlyPricingStrategy>());
+        for (int f = 0; f < 2; f++)
+        {
+            auto floor = make_unique<ParkingFloor>(f);
+            for (int i = 0; i < 1000; i++)
+                floor->addSpot("F" + to_string(f) + "S" + to_string(i), SpotType::CAR);
+            lot->addFloor(move(floor));
+        }
+        return lot;
+    };
+
+    {
+        auto lot = buildLot();
+        Vehicle car("SOLO", VehicleType::CAR);
+        NoOpPayment payment;
+        const int rounds = 500000;
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++)
+            lot->unparkVehicle(lot->parkVehicle(car), payment);
+        cout << "  single gate park+unpark " << chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / rounds << " ns\n";
+    }
+
+    // 4 gates on 2 floors, so the floor locks see contention
+    ParkingMetrics::reset();
+    auto lot = buildLot();
+    vector<thread> gates;
+    for (int g = 0; g < 4; g++)
+        gates.emplace_back([&, g]()
+                           {
+            Vehicle car("Car_" + to_string(g), VehicleType::CAR);
+            NoOpPayment payment;
+            for (int i = 0; i < 100000; i++)
+                lot->unparkVehicle(lot->parkVehicle(car, g), payment); });
+    for (auto &t : gates)
+        t.join();
+    ParkingMetrics::snapshot().print(cout);
+}
+
+// A multi-floor lot through the builder API (ParkingSpotFactory + addSpot): 10% bike, 20% truck spots,
+// distance = position on the floor. What ./main genmap saves as a spot map.
+void buildStandardLayout(ParkingLot &lot, int floors, int spotsPerFloor)
+{
+    for (int f = 0; f < floors; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < spotsPerFloor; i++)
+        {
+            SpotType type = i % 10 == 0 ? SpotType::BIKE : (i % 5 == 1 ? SpotType::TRUCK : SpotType::CAR);
+            auto spot = ParkingSpotFactory::createSpot("F" + to_string(f) + "-S" + to_string(i), type);
+            floor->addSpot(spot->getSpotId(), spot->getType(), i);
+        }
+        lot.addFloor(move(floor));
+    }
+}
+
+static long minorFaults()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// 200k spots: built spot by spot vs mapped from a spot map file
+void benchmarkSpotMap()
+{
+    cout << "startup of a 200k-spot lot (20 floors x 10000): builder vs spot map\n";
+    const string path = "bench.spotmap";
+
+    auto t0 = chrono::steady_clock::now();
+    long faults0 = minorFaults();
+    auto built = make_unique<ParkingLot>(make_unique<HourlyPricingStrategy>());
+    buildStandardLayout(*built, 20, 10000);
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    long buildFaults = minorFaults() - faults0;
+
+    t0 = chrono::steady_clock::now();
+    bool written = built->writeSpotMap(path);
+    double writeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    struct stat info;
+    stat(path.c_str(), &info);
+
+    t0 = chrono::steady_clock::now();
+    faults0 = minorFaults();
+    auto mapped = make_unique<ParkingLot>(make_unique<HourlyPricingStrategy>());
+    bool loaded = mapped->loadSpotMap(path);
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    long loadFaults = minorFaults() - faults0;
+
+    cout << "  builder: " << buildMs << " ms, " << buildFaults << " page faults\n"
+         << "  writeSpotMap: " << (written ? "ok" : "FAILED") << " in " << writeMs << " ms, " << info.st_size / 1024 << " KiB\n"
+         << "  loadSpotMap: " << (loaded ? "ok" : "FAILED") << " in " << loadMs << " ms, " << loadFaults << " page faults\n";
+
+    // same lot either way: counts, ids and the spots handed out
+    vector<Vehicle> cars;
+    for (int i = 0; i < 1000; i++)
+        cars.emplace_back("MAP_" + to_string(i), VehicleType::CAR);
+    vector<TicketId> builtTickets = built->parkVehicles(cars);
+    faults0 = minorFaults();
+    vector<TicketId> mappedTickets = mapped->parkVehicles(cars);
+    long parkFaults = minorFaults() - faults0;
+    bool same = built->getFreeSpots(SpotType::CAR) == mapped->getFreeSpots(SpotType::CAR) and
+                built->getFreeSpots(SpotType::TRUCK) == mapped->getFreeSpots(SpotType::TRUCK);
+    for (int i = 0; i < 1000 and same; i += 97)
+    {
+        VehicleLocation a, b;
+        same = built->findVehicle(cars[i].getVehicleId(), a) and mapped->findVehicle(cars[i].getVehicleId(), b) and
+               a.floorNumber == b.floorNumber and a.spotId == b.spotId;
+    }
+    NoOpPayment payment;
+    built->unparkVehicles(builtTickets, payment);
+    mapped->unparkVehicles(mappedTickets, payment);
+    cout << "  1000 cars parked in both: " << (same ? "same spots" : "MISMATCH") << ", " << mapped->getFreeSpots(SpotType::CAR)
+         << " car spots free after they left, " << parkFaults << " page faults to park them in the mapped lot\n";
+    remove(path.c_str());
+}
+
+// default regression scenario: a week of traffic into a 2000-spot lot
+SimulationReport runStandardSimulation(double arrivalsPerHour, double hours)
+{
+    auto clock = make_shared<VirtualClock>();
+    ParkingLot lot(make_unique<HourlyPricingStrategy>(), clock);
+    for (int f = 0; f < 4; f++)
+    {
+        auto floor = make_unique<ParkingFloor>(f);
+        for (int i = 0; i < 500; i++)
+        {
+            SpotType type = i < 100 ? SpotType::BIKE : (i < 425 ? SpotType::CAR : SpotType::TRUCK);
+            floor->addSpot("F" + to_string(f) + "S" + to_string(i), type);
+        }
+        lot.addFloor(move(floor));
+    }
+    SimulationConfig config;
+    config.arrivalsPerHour = arrivalsPerHour;
+    config.hours = hours;
+    return ParkingSimulator::run(lot, *clock, ParkingSimulator::generateTrace(config), config.occupancySample);
+}
+
+int main(int argc, char *argv[])
+{
+    // ./main simulate [arrivalsPerHour] [hours]
+    if (argc > 1 and string(argv[1]) == "simulate")
+    {
+        double rate = argc > 2 ? atof(argv[2]) : 900;
+        double hours = argc > 3 ? atof(argv[3]) : 24 * 7;
+        cout << "simulation: " << rate << " arrivals/h for " << hours << " h\n";
+        runStandardSimulation(rate, hours).print(cout);
+        return 0;
+    }
+
+    // ./main genmap <file> [floors] [spotsPerFloor]: build a lot with the builder API, save it as a spot map
+    if (argc > 2 and string(argv[1]) == "genmap")
+    {
+        int floors = argc > 3 ? atoi(argv[3]) : 20;
+        int spotsPerFloor = argc > 4 ? atoi(argv[4]) : 10000;
+        ParkingLot lot(make_unique<HourlyPricingStrategy>());
+        buildStandardLayout(lot, floors, spotsPerFloor);
+        if (!lot.writeSpotMap(argv[2]))
+        {
+            cerr << "could not write " << argv[2] << "\n";
+            return 1;
+        }
+        cout << "wrote " << floors << " floors x " << spotsPerFloor << " spots to " << argv[2] << "\n";
+        return 0;
+    }
+
+    if (argc > 1 and string(argv[1]) == "bench")
+    {
+        benchmarkSpotIndex();
+        benchmarkSpotStorage();
+        benchmarkGateThroughput();
+        benchmarkHotReconfiguration();
+        benchmarkBatchPark();
+        benchmarkRecovery();
+        benchmarkShardedLots();
+        benchmarkVehicleOwnership();
+        benchmarkBatchPricing();
+        benchmarkDynamicPricing();
+        benchmarkAllocationPolicies();
+        benchmarkVehicleIndex();
+        benchmarkClocks();
+        benchmarkReservations();
+        benchmarkAsyncPayments();
+        benchmarkMetrics();
+        benchmarkSpotMap();
+        cout << "simulation: 900 arrivals/h for one week\n";
+        runStandardSimulation(900, 24 * 7).print(cout);
+        return 0;
+    }
+
+    // Use unique_ptr when:
+    // There is exactly ONE owner
+    // 🔹 Use shared_ptr when:
+    // Multiple objects need to refer to it safely
+
+    // 1. create parking lot with floors, spots, and pricing strategy.
     // 2. create vehicle, give entry via ticket, make exit via delete ticket
     // Pricing strategy
     unique_ptr<PricingStrategy> pricing = make_unique<HourlyPricingStrategy>();
@@ -341,12 +5447,22 @@ int main()
     parkingLot.addFloor(move(floor1));
 
     auto car = VehicleFactory::createVehicle("Car_101", VehicleType::CAR);
-    string ticket = parkingLot.parkVehicle(car);
-    if (ticket == "")
+    TicketId ticket = parkingLot.parkVehicle(*car);
+    if (ticket == INVALID_TICKET)
     {
         cout << "Parking lot is full\n";
         return 0;
     }
+    cout << "Issued " << ticketToString(ticket) << "\n";
+
+    for (const FloorAvailability &floor : parkingLot.getAvailability())
+    {
+        cout << "Floor " << floor.floorNumber
+             << ": bike " << floor.freeSpots[static_cast<int>(SpotType::BIKE)] << "/" << floor.totalSpots[static_cast<int>(SpotType::BIKE)]
+             << ", car " << floor.freeSpots[static_cast<int>(SpotType::CAR)] << "/" << floor.totalSpots[static_cast<int>(SpotType::CAR)]
+             << ", truck " << floor.freeSpots[static_cast<int>(SpotType::TRUCK)] << "/" << floor.totalSpots[static_cast<int>(SpotType::TRUCK)]
+             << " free\n";
+    }
 
     // simulate sleep
     sleep(2);